@@ -5,11 +5,14 @@
 #include "formats.h"
 #include "globvars.h"
 #include "globvrbm.h"
+#include "harness/config.h"
 #include "harness/trace.h"
 #include "init.h"
+#include "loading.h"
 #include "pd/sys.h"
 #include "utility.h"
 #include "world.h"
+#include <float.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -63,6 +66,10 @@ void DisposeColumns(tTrack_spec* pTrack_spec) {
     if (pTrack_spec->non_car_list != NULL && (0 < pTrack_spec->ampersand_digits)) {
         BrMemFree(pTrack_spec->non_car_list);
     }
+    // Added by dethrace
+    DisposeFaceGrid(pTrack_spec);
+    DisposeColumnVisibility(pTrack_spec);
+    DisposeVisibleColumns();
 }
 
 // IDA: void __usercall XZToColumnXZ(tU8 *pColumn_x@<EAX>, tU8 *pColumn_z@<EDX>, br_scalar pX, br_scalar pZ, tTrack_spec *pTrack_spec)
@@ -287,6 +294,721 @@ void ExtractColumns(tTrack_spec* pTrack_spec) {
     } else {
         ProcessModels(pTrack_spec);
     }
+    // Added by dethrace
+    BuildFaceGrid(pTrack_spec);
+}
+
+// Added by dethrace: a face slot in the grid. Counts only, while the arrays have not been allocated yet
+static tFace_grid_face_info* AddFaceGridEntry(tFace_grid* pGrid, tFace_grid_cell* pCell) {
+    int i;
+
+    i = pGrid->nfaces;
+    pGrid->nfaces++;
+    pCell->count++;
+    if (pGrid->info == NULL) {
+        return NULL;
+    }
+    return &pGrid->info[i];
+}
+
+// Added by dethrace: mirrors the walk ActorBoxPick does for untransformed track actors.
+// Faces are emitted in the order ActorBoxPick would find them, so collisions come out identical.
+// Ampersand actors move (and can be hidden), bounds actors prune their children: both are kept as
+// an actor entry and walked by ActorBoxPick at query time.
+static void AddFaceGridActor(tFace_grid* pGrid, tFace_grid_cell* pCell, br_actor* pActor, br_model* pModel, br_material* pMaterial, br_actor* pBlend) {
+    br_model* this_model;
+    br_material* this_material;
+    struct v11model* prepared;
+    struct v11group* grp_ptr;
+    tFace_grid_face_info* info;
+    tFace_grid_face* face;
+    br_actor* a;
+    int group;
+    int f;
+    int v;
+    int i;
+
+    if ((pActor->identifier != NULL && pActor->identifier[0] == '&')
+        || pActor->type == BR_ACTOR_BOUNDS
+        || pActor->type == BR_ACTOR_BOUNDS_CORRECT) {
+        info = AddFaceGridEntry(pGrid, pCell);
+        pCell->has_actors = 1;
+        if (info != NULL) {
+            info->group = NULL;
+            info->actor = pActor;
+            info->model = pModel;
+            info->material = pMaterial;
+        }
+        return;
+    }
+    // blends are hidden from the renderer, but FindFacesInBox always collides with them
+    if (pActor->render_style == BR_RSTYLE_NONE && pActor != pBlend) {
+        return;
+    }
+    this_model = pActor->model != NULL ? pActor->model : pModel;
+    this_material = pActor->material != NULL ? pActor->material : pMaterial;
+    if (pActor->type == BR_ACTOR_MODEL && this_model != NULL && this_model->prepared != NULL) {
+        prepared = this_model->prepared;
+        for (group = 0; group < prepared->ngroups; group++) {
+            grp_ptr = &prepared->groups[group];
+            for (f = 0; f < grp_ptr->nfaces; f++) {
+                info = AddFaceGridEntry(pGrid, pCell);
+                if (info == NULL) {
+                    continue;
+                }
+                face = &pGrid->faces[info - pGrid->info];
+                info->group = grp_ptr;
+                info->actor = pActor;
+                info->model = this_model;
+                info->material = this_material;
+                for (v = 0; v < 3; v++) {
+                    info->vertex_numbers[v] = grp_ptr->vertex_numbers[f].v[v];
+                    BrVector3Copy(&face->v[v], &grp_ptr->position[info->vertex_numbers[v]]);
+                }
+                info->flags = (info->vertex_numbers[0] < info->vertex_numbers[1])
+                    | (info->vertex_numbers[1] < info->vertex_numbers[2]) << 1
+                    | (info->vertex_numbers[2] < info->vertex_numbers[0]) << 2;
+                for (i = 0; i < 4; i++) {
+                    face->eqn.v[i] = grp_ptr->eqn[f].v[i];
+                }
+                BrVector3Copy(&face->bounds.min, &face->v[0]);
+                BrVector3Copy(&face->bounds.max, &face->v[0]);
+                for (v = 1; v < 3; v++) {
+                    for (i = 0; i < 3; i++) {
+                        face->bounds.min.v[i] = MIN(face->bounds.min.v[i], face->v[v].v[i]);
+                        face->bounds.max.v[i] = MAX(face->bounds.max.v[i], face->v[v].v[i]);
+                    }
+                }
+                for (i = 0; i < 3; i++) {
+                    pCell->bounds.min.v[i] = MIN(pCell->bounds.min.v[i], face->bounds.min.v[i]);
+                    pCell->bounds.max.v[i] = MAX(pCell->bounds.max.v[i], face->bounds.max.v[i]);
+                }
+            }
+        }
+    }
+    for (a = pActor->children; a != NULL; a = a->next) {
+        AddFaceGridActor(pGrid, pCell, a, this_model, this_material, pBlend);
+    }
+}
+
+// Added by dethrace: walks every column and lollipop actor, once to count the faces and once to fill them in
+static void FillFaceGrid(tTrack_spec* pTrack_spec) {
+    tFace_grid* grid;
+    tFace_grid_cell* cell;
+    int x;
+    int z;
+
+    grid = &pTrack_spec->face_grid;
+    grid->nfaces = 0;
+    for (z = 0; z < pTrack_spec->ncolumns_z; z++) {
+        for (x = 0; x < pTrack_spec->ncolumns_x; x++) {
+            cell = &grid->cells[z * pTrack_spec->ncolumns_x + x];
+            cell->first = grid->nfaces;
+            cell->count = 0;
+            cell->has_actors = 0;
+            // inside out until the first face is added, so an empty cell never overlaps anything
+            BrVector3Set(&cell->bounds.min, FLT_MAX, FLT_MAX, FLT_MAX);
+            BrVector3Set(&cell->bounds.max, -FLT_MAX, -FLT_MAX, -FLT_MAX);
+            if (pTrack_spec->columns[z][x] != NULL) {
+                AddFaceGridActor(grid, cell, pTrack_spec->columns[z][x], NULL, NULL, pTrack_spec->blends[z][x]);
+            }
+            if (pTrack_spec->lollipops[z][x] != NULL) {
+                AddFaceGridActor(grid, cell, pTrack_spec->lollipops[z][x], NULL, NULL, NULL);
+            }
+        }
+    }
+}
+
+// Added by dethrace
+void BuildFaceGrid(tTrack_spec* pTrack_spec) {
+    tFace_grid* grid;
+    int ncells;
+    LOG_TRACE("(%p)", pTrack_spec);
+
+    DisposeFaceGrid(pTrack_spec);
+    grid = &pTrack_spec->face_grid;
+    ncells = pTrack_spec->ncolumns_x * pTrack_spec->ncolumns_z;
+    grid->cells = BrMemAllocate(sizeof(tFace_grid_cell) * ncells, kMem_face_grid);
+    FillFaceGrid(pTrack_spec);
+    grid->nfaces_allocated = grid->nfaces;
+    if (grid->nfaces != 0) {
+        grid->faces = BrMemAllocate(sizeof(tFace_grid_face) * grid->nfaces, kMem_face_grid);
+        grid->info = BrMemAllocate(sizeof(tFace_grid_face_info) * grid->nfaces, kMem_face_grid);
+        FillFaceGrid(pTrack_spec);
+    }
+    dr_dprintf("Face grid: %d faces in %d columns", grid->nfaces, ncells);
+}
+
+// Added by dethrace: the grid points into the prepared models, so it is built again whenever they are replaced.
+// Nothing to do before it has been built in the first place
+void RefreshFaceGrid(tTrack_spec* pTrack_spec) {
+    LOG_TRACE("(%p)", pTrack_spec);
+
+    if (pTrack_spec->face_grid.cells != NULL) {
+        BuildFaceGrid(pTrack_spec);
+    }
+}
+
+// Added by dethrace
+void DisposeFaceGrid(tTrack_spec* pTrack_spec) {
+    tFace_grid* grid;
+    LOG_TRACE("(%p)", pTrack_spec);
+
+    grid = &pTrack_spec->face_grid;
+    if (grid->cells != NULL) {
+        BrMemFree(grid->cells);
+    }
+    if (grid->faces != NULL) {
+        BrMemFree(grid->faces);
+    }
+    if (grid->info != NULL) {
+        BrMemFree(grid->info);
+    }
+    memset(grid, 0, sizeof(tFace_grid));
+}
+
+// Added by dethrace: .PVS file layout, all little endian. Header, then both eye heights of every column, then the rows
+#define PVS_FILE_MAGIC 0x53565044 // "DPVS"
+#define PVS_FILE_VERSION 1
+// Added by dethrace: baking casts rays between PVS_SAMPLES^2 points across each viewing column at PVS_EYE_LEVELS heights
+// and PVS_SAMPLES^3 points over each column it might see
+#define PVS_SAMPLES 3
+#define PVS_EYE_LEVELS 2
+// Added by dethrace: baked range, as a multiple of the yon distance in use while baking, to reach the far plane corners
+#define PVS_RANGE_FACTOR 1.5f
+#define PVS_OCCLUDER_ONE_SIDED 1
+#define PVS_OCCLUDER_TWO_SIDED 2
+
+// Added by dethrace
+void DisposeColumnVisibility(tTrack_spec* pTrack_spec) {
+    tColumn_visibility* visibility;
+    LOG_TRACE("(%p)", pTrack_spec);
+
+    visibility = &pTrack_spec->column_visibility;
+    if (visibility->bits != NULL) {
+        BrMemFree(visibility->bits);
+    }
+    if (visibility->eye_heights != NULL) {
+        BrMemFree(visibility->eye_heights);
+    }
+    memset(visibility, 0, sizeof(tColumn_visibility));
+}
+
+// Added by dethrace
+static void AllocateColumnVisibility(tTrack_spec* pTrack_spec) {
+    tColumn_visibility* visibility;
+    int ncells;
+
+    DisposeColumnVisibility(pTrack_spec);
+    visibility = &pTrack_spec->column_visibility;
+    ncells = pTrack_spec->ncolumns_x * pTrack_spec->ncolumns_z;
+    visibility->row_bytes = (ncells + 7) / 8;
+    visibility->bits = BrMemAllocate(visibility->row_bytes * ncells, kMem_column_visibility);
+    visibility->eye_heights = BrMemAllocate(sizeof(br_scalar) * 2 * ncells, kMem_column_visibility);
+    memset(visibility->bits, 0, visibility->row_bytes * ncells);
+}
+
+// Added by dethrace
+static void SetColumnVisible(tTrack_spec* pTrack_spec, tU8* pRow, int pColumn_x, int pColumn_z) {
+    int cell;
+
+    if (pColumn_x < 0 || pColumn_x >= pTrack_spec->ncolumns_x || pColumn_z < 0 || pColumn_z >= pTrack_spec->ncolumns_z) {
+        return;
+    }
+    cell = pColumn_z * pTrack_spec->ncolumns_x + pColumn_x;
+    pRow[cell >> 3] |= 1 << (cell & 7);
+}
+
+// Added by dethrace: textures with colour 0 in them can be seen through
+static int MaterialIsOpaque(br_material* pMaterial) {
+    br_pixelmap* map;
+    tU8* row;
+    int x;
+    int y;
+
+    if (pMaterial == NULL || pMaterial->colour_map == NULL) {
+        return 1;
+    }
+    map = pMaterial->colour_map;
+    if (map->pixels == NULL || map->type != BR_PMT_INDEX_8) {
+        return 0;
+    }
+    for (y = 0; y < map->height; y++) {
+        row = (tU8*)map->pixels + (map->base_y + y) * map->row_bytes + map->base_x;
+        for (x = 0; x < map->width; x++) {
+            if (row[x] == 0) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Added by dethrace: whether `pActor` hangs off `pAncestor`, or is it
+static int ActorIsBelow(br_actor* pActor, br_actor* pAncestor) {
+
+    for (; pActor != NULL; pActor = pActor->parent) {
+        if (pActor == pAncestor) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Added by dethrace
+// Which faces of the grid hide what is behind them: opaque, visible, and neither blended nor a lollipop billboard.
+// Moveable actors are left out as they may not be there
+static tU8* FindColumnOccluders(tTrack_spec* pTrack_spec) {
+    static br_material* materials[256];
+    static tU8 opaque[256];
+    tFace_grid* grid;
+    tFace_grid_cell* cell;
+    tFace_grid_face_info* info;
+    br_material* material;
+    tU8* occluders;
+    int number_of_materials;
+    int is_opaque;
+    int x;
+    int z;
+    int f;
+    int i;
+
+    grid = &pTrack_spec->face_grid;
+    occluders = BrMemAllocate(MAX(grid->nfaces, 1), kMem_column_visibility);
+    memset(occluders, 0, MAX(grid->nfaces, 1));
+    number_of_materials = 0;
+    for (z = 0; z < pTrack_spec->ncolumns_z; z++) {
+        for (x = 0; x < pTrack_spec->ncolumns_x; x++) {
+            cell = &grid->cells[z * pTrack_spec->ncolumns_x + x];
+            for (f = cell->first; f < cell->first + cell->count; f++) {
+                info = &grid->info[f];
+                if (info->group == NULL
+                    || ActorIsBelow(info->actor, pTrack_spec->blends[z][x])
+                    || ActorIsBelow(info->actor, pTrack_spec->lollipops[z][x])) {
+                    continue;
+                }
+                material = info->group->user != NULL ? info->group->user : info->material;
+                for (i = 0; i < number_of_materials && materials[i] != material; i++) {
+                }
+                if (i < number_of_materials) {
+                    is_opaque = opaque[i];
+                } else {
+                    is_opaque = MaterialIsOpaque(material);
+                    if (number_of_materials < (int)COUNT_OF(materials)) {
+                        materials[number_of_materials] = material;
+                        opaque[number_of_materials] = is_opaque;
+                        number_of_materials++;
+                    }
+                }
+                if (!is_opaque) {
+                    continue;
+                }
+                if (material != NULL && (material->flags & (BR_MATF_TWO_SIDED | BR_MATF_ALWAYS_VISIBLE)) != 0) {
+                    occluders[f] = PVS_OCCLUDER_TWO_SIDED;
+                } else {
+                    occluders[f] = PVS_OCCLUDER_ONE_SIDED;
+                }
+            }
+        }
+    }
+    return occluders;
+}
+
+// Added by dethrace
+static int SegmentHitsFace(tFace_grid_face* pFace, int pOccluder, br_vector3* pFrom, br_vector3* pDir) {
+    br_vector3 e1;
+    br_vector3 e2;
+    br_vector3 p;
+    br_vector3 q;
+    br_vector3 s;
+    br_scalar det;
+    br_scalar u;
+    br_scalar v;
+    br_scalar t;
+
+    if (pOccluder == PVS_OCCLUDER_ONE_SIDED && BrVector3Dot((br_vector3*)&pFace->eqn, pDir) >= 0.f) {
+        return 0;
+    }
+    BrVector3Sub(&e1, &pFace->v[1], &pFace->v[0]);
+    BrVector3Sub(&e2, &pFace->v[2], &pFace->v[0]);
+    BrVector3Cross(&p, pDir, &e2);
+    det = BrVector3Dot(&e1, &p);
+    if (fabsf(det) < 1e-9f) {
+        return 0;
+    }
+    BrVector3Sub(&s, pFrom, &pFace->v[0]);
+    u = BrVector3Dot(&s, &p) / det;
+    if (u < 0.f || u > 1.f) {
+        return 0;
+    }
+    BrVector3Cross(&q, &s, &e1);
+    v = BrVector3Dot(pDir, &q) / det;
+    if (v < 0.f || u + v > 1.f) {
+        return 0;
+    }
+    t = BrVector3Dot(&e2, &q) / det;
+    return t > 0.001f && t < 0.999f;
+}
+
+// Added by dethrace
+// Whether an occluder lies between two points. The columns being tested are left out, so they cannot hide themselves and
+// a viewpoint inside a building still sees out. Columns are visited in half column steps along the segment. Faces that
+// overhang into a column the segment crosses but the steps miss are not tried, which can only let more through
+static int SegmentBlocked(tTrack_spec* pTrack_spec, tU8* pOccluders, br_vector3* pFrom, br_vector3* pTo, int pSkip_1, int pSkip_2) {
+    tFace_grid* grid;
+    tFace_grid_cell* cell;
+    tFace_grid_face* face;
+    br_vector3 dir;
+    br_bounds segment_bounds;
+    br_scalar step;
+    br_scalar t;
+    tU8 column_x;
+    tU8 column_z;
+    int number_of_steps;
+    int last_cell;
+    int this_cell;
+    int i;
+    int f;
+
+    grid = &pTrack_spec->face_grid;
+    BrVector3Sub(&dir, pTo, pFrom);
+    for (i = 0; i < 3; i++) {
+        segment_bounds.min.v[i] = MIN(pFrom->v[i], pTo->v[i]);
+        segment_bounds.max.v[i] = MAX(pFrom->v[i], pTo->v[i]);
+    }
+    step = MIN(pTrack_spec->column_size_x, pTrack_spec->column_size_z) / 2.f;
+    number_of_steps = (int)(sqrtf(dir.v[0] * dir.v[0] + dir.v[2] * dir.v[2]) / step) + 1;
+    last_cell = -1;
+    for (i = 0; i <= number_of_steps; i++) {
+        t = (br_scalar)i / number_of_steps;
+        XZToColumnXZ(&column_x, &column_z, pFrom->v[0] + dir.v[0] * t, pFrom->v[2] + dir.v[2] * t, pTrack_spec);
+        this_cell = column_z * pTrack_spec->ncolumns_x + column_x;
+        if (this_cell == last_cell) {
+            continue;
+        }
+        last_cell = this_cell;
+        if (this_cell == pSkip_1 || this_cell == pSkip_2) {
+            continue;
+        }
+        cell = &grid->cells[this_cell];
+        if (cell->count == 0
+            || cell->bounds.min.v[0] > segment_bounds.max.v[0] || cell->bounds.max.v[0] < segment_bounds.min.v[0]
+            || cell->bounds.min.v[1] > segment_bounds.max.v[1] || cell->bounds.max.v[1] < segment_bounds.min.v[1]
+            || cell->bounds.min.v[2] > segment_bounds.max.v[2] || cell->bounds.max.v[2] < segment_bounds.min.v[2]) {
+            continue;
+        }
+        for (f = cell->first; f < cell->first + cell->count; f++) {
+            if (pOccluders[f] == 0) {
+                continue;
+            }
+            face = &grid->faces[f];
+            if (face->bounds.min.v[0] > segment_bounds.max.v[0] || face->bounds.max.v[0] < segment_bounds.min.v[0]
+                || face->bounds.min.v[1] > segment_bounds.max.v[1] || face->bounds.max.v[1] < segment_bounds.min.v[1]
+                || face->bounds.min.v[2] > segment_bounds.max.v[2] || face->bounds.max.v[2] < segment_bounds.min.v[2]) {
+                continue;
+            }
+            if (SegmentHitsFace(face, pOccluders[f], pFrom, &dir)) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Added by dethrace: the box a column's contents can occupy. Non-cars are re-parented to whichever column they stand in
+static void ColumnContentBounds(tTrack_spec* pTrack_spec, int pColumn_x, int pColumn_z, br_scalar pHeadroom, br_bounds* pBounds) {
+    tFace_grid_cell* cell;
+
+    cell = &pTrack_spec->face_grid.cells[pColumn_z * pTrack_spec->ncolumns_x + pColumn_x];
+    pBounds->min.v[0] = MIN(cell->bounds.min.v[0], pTrack_spec->origin_x + pColumn_x * pTrack_spec->column_size_x);
+    pBounds->max.v[0] = MAX(cell->bounds.max.v[0], pTrack_spec->origin_x + (pColumn_x + 1) * pTrack_spec->column_size_x);
+    pBounds->min.v[1] = cell->bounds.min.v[1];
+    pBounds->max.v[1] = cell->bounds.max.v[1] + pHeadroom;
+    pBounds->min.v[2] = MIN(cell->bounds.min.v[2], pTrack_spec->origin_z + pColumn_z * pTrack_spec->column_size_z);
+    pBounds->max.v[2] = MAX(cell->bounds.max.v[2], pTrack_spec->origin_z + (pColumn_z + 1) * pTrack_spec->column_size_z);
+}
+
+// Added by dethrace
+static int ColumnPairVisible(tTrack_spec* pTrack_spec, tU8* pOccluders, br_vector3* pEyes, int pNumber_of_eyes, br_bounds* pTarget, int pFrom_cell, int pTo_cell) {
+    br_vector3 target;
+    int i;
+    int x;
+    int y;
+    int z;
+
+    for (y = 0; y < PVS_SAMPLES; y++) {
+        for (z = 0; z < PVS_SAMPLES; z++) {
+            for (x = 0; x < PVS_SAMPLES; x++) {
+                target.v[0] = pTarget->min.v[0] + (pTarget->max.v[0] - pTarget->min.v[0]) * x / (PVS_SAMPLES - 1);
+                target.v[1] = pTarget->min.v[1] + (pTarget->max.v[1] - pTarget->min.v[1]) * y / (PVS_SAMPLES - 1);
+                target.v[2] = pTarget->min.v[2] + (pTarget->max.v[2] - pTarget->min.v[2]) * z / (PVS_SAMPLES - 1);
+                for (i = 0; i < pNumber_of_eyes; i++) {
+                    if (!SegmentBlocked(pTrack_spec, pOccluders, &pEyes[i], &target, pFrom_cell, pTo_cell)) {
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+// Added by dethrace
+// Sample which columns can be seen from each column through the static track faces. Rays can slip between samples, so
+// every column found is grown by its neighbours, and columns with nothing static to stand on see everything
+static void BakeColumnVisibility(tTrack_spec* pTrack_spec) {
+    tColumn_visibility* visibility;
+    tFace_grid_cell* from_cell;
+    tFace_grid_cell* to_cell;
+    br_vector3 eyes[PVS_SAMPLES * PVS_SAMPLES * PVS_EYE_LEVELS];
+    br_bounds target;
+    br_scalar headroom;
+    br_scalar dx;
+    br_scalar dz;
+    tU8* occluders;
+    tU8* found;
+    tU8* row;
+    int number_of_eyes;
+    int from_x;
+    int from_z;
+    int to_x;
+    int to_z;
+    int i;
+    int j;
+    int k;
+
+    AllocateColumnVisibility(pTrack_spec);
+    visibility = &pTrack_spec->column_visibility;
+    visibility->range = gCamera_yon * gYon_multiplier * PVS_RANGE_FACTOR;
+    headroom = MAX(pTrack_spec->column_size_x, pTrack_spec->column_size_z);
+    occluders = FindColumnOccluders(pTrack_spec);
+    found = BrMemAllocate(visibility->row_bytes, kMem_column_visibility);
+
+    for (from_z = 0; from_z < pTrack_spec->ncolumns_z; from_z++) {
+        for (from_x = 0; from_x < pTrack_spec->ncolumns_x; from_x++) {
+            PossibleService();
+            i = from_z * pTrack_spec->ncolumns_x + from_x;
+            from_cell = &pTrack_spec->face_grid.cells[i];
+            row = &visibility->bits[i * visibility->row_bytes];
+            if (from_cell->count == 0) {
+                visibility->eye_heights[2 * i] = -FLT_MAX;
+                visibility->eye_heights[2 * i + 1] = FLT_MAX;
+                memset(row, 0xff, visibility->row_bytes);
+                continue;
+            }
+            visibility->eye_heights[2 * i] = from_cell->bounds.min.v[1];
+            visibility->eye_heights[2 * i + 1] = from_cell->bounds.max.v[1] + headroom;
+            number_of_eyes = 0;
+            for (j = 0; j < PVS_EYE_LEVELS; j++) {
+                for (k = 0; k < PVS_SAMPLES * PVS_SAMPLES; k++) {
+                    eyes[number_of_eyes].v[0] = pTrack_spec->origin_x + (from_x + (br_scalar)(k % PVS_SAMPLES) / (PVS_SAMPLES - 1)) * pTrack_spec->column_size_x;
+                    eyes[number_of_eyes].v[1] = visibility->eye_heights[2 * i] + (visibility->eye_heights[2 * i + 1] - visibility->eye_heights[2 * i]) * (j + 1) / PVS_EYE_LEVELS;
+                    eyes[number_of_eyes].v[2] = pTrack_spec->origin_z + (from_z + (br_scalar)(k / PVS_SAMPLES) / (PVS_SAMPLES - 1)) * pTrack_spec->column_size_z;
+                    number_of_eyes++;
+                }
+            }
+
+            memset(found, 0, visibility->row_bytes);
+            for (to_z = 0; to_z < pTrack_spec->ncolumns_z; to_z++) {
+                for (to_x = 0; to_x < pTrack_spec->ncolumns_x; to_x++) {
+                    j = to_z * pTrack_spec->ncolumns_x + to_x;
+                    to_cell = &pTrack_spec->face_grid.cells[j];
+                    if (abs(to_x - from_x) <= 1 && abs(to_z - from_z) <= 1) {
+                        SetColumnVisible(pTrack_spec, found, to_x, to_z);
+                        continue;
+                    }
+                    if (pTrack_spec->columns[to_z][to_x] == NULL && pTrack_spec->lollipops[to_z][to_x] == NULL && pTrack_spec->blends[to_z][to_x] == NULL) {
+                        continue;
+                    }
+                    if (to_cell->count == 0) {
+                        // only moveable actors, with no static faces to say where they are
+                        SetColumnVisible(pTrack_spec, found, to_x, to_z);
+                        continue;
+                    }
+                    ColumnContentBounds(pTrack_spec, to_x, to_z, headroom, &target);
+                    dx = MAX(0.f, MAX(target.min.v[0] - (pTrack_spec->origin_x + (from_x + 1) * pTrack_spec->column_size_x), pTrack_spec->origin_x + from_x * pTrack_spec->column_size_x - target.max.v[0]));
+                    dz = MAX(0.f, MAX(target.min.v[2] - (pTrack_spec->origin_z + (from_z + 1) * pTrack_spec->column_size_z), pTrack_spec->origin_z + from_z * pTrack_spec->column_size_z - target.max.v[2]));
+                    if (dx * dx + dz * dz > visibility->range * visibility->range) {
+                        continue;
+                    }
+                    if (ColumnPairVisible(pTrack_spec, occluders, eyes, number_of_eyes, &target, i, j)) {
+                        SetColumnVisible(pTrack_spec, found, to_x, to_z);
+                    }
+                }
+            }
+            for (to_z = 0; to_z < pTrack_spec->ncolumns_z; to_z++) {
+                for (to_x = 0; to_x < pTrack_spec->ncolumns_x; to_x++) {
+                    j = to_z * pTrack_spec->ncolumns_x + to_x;
+                    if ((found[j >> 3] & (1 << (j & 7))) == 0) {
+                        continue;
+                    }
+                    for (k = 0; k < 9; k++) {
+                        SetColumnVisible(pTrack_spec, row, to_x + k % 3 - 1, to_z + k / 3 - 1);
+                    }
+                }
+            }
+        }
+        dr_dprintf("Baking column visibility: row %d of %d", from_z + 1, pTrack_spec->ncolumns_z);
+    }
+    BrMemFree(found);
+    BrMemFree(occluders);
+}
+
+// Added by dethrace
+static void ColumnVisibilityPath(char* pDest, char* pActor_path) {
+    char* dot;
+
+    strcpy(pDest, pActor_path);
+    dot = strrchr(pDest, '.');
+    if (dot == NULL || strpbrk(dot, "/\\") != NULL) {
+        dot = pDest + strlen(pDest);
+    }
+    strcpy(dot, ".PVS");
+}
+
+// Added by dethrace
+static void WriteScalar(FILE* pF, br_scalar pValue) {
+    tU32 bits;
+
+    memcpy(&bits, &pValue, sizeof(bits));
+    WriteU32L(pF, bits);
+}
+
+// Added by dethrace
+static br_scalar ReadScalar(FILE* pF) {
+    br_scalar value;
+    tU32 bits;
+
+    bits = ReadU32(pF);
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Added by dethrace
+static void WriteColumnVisibility(tTrack_spec* pTrack_spec, char* pPath) {
+    tColumn_visibility* visibility;
+    char temp_path[256];
+    FILE* f;
+    int ncells;
+    int i;
+
+    visibility = &pTrack_spec->column_visibility;
+    f = OpenDerivedAssetForWriting(pPath, temp_path);
+    if (f == NULL) {
+        return;
+    }
+    ncells = pTrack_spec->ncolumns_x * pTrack_spec->ncolumns_z;
+    WriteU32L(f, PVS_FILE_MAGIC);
+    WriteU32L(f, PVS_FILE_VERSION);
+    WriteU32L(f, pTrack_spec->ncolumns_x);
+    WriteU32L(f, pTrack_spec->ncolumns_z);
+    WriteU32L(f, pTrack_spec->face_grid.nfaces);
+    WriteScalar(f, pTrack_spec->column_size_x);
+    WriteScalar(f, pTrack_spec->column_size_z);
+    WriteScalar(f, visibility->range);
+    for (i = 0; i < 2 * ncells; i++) {
+        WriteScalar(f, visibility->eye_heights[i]);
+    }
+    fwrite(visibility->bits, visibility->row_bytes, ncells, f);
+    CommitDerivedAsset(f, pPath, temp_path);
+    dr_dprintf("Wrote column visibility to \"%s\"", pPath);
+}
+
+// Added by dethrace: a .PVS baked from different geometry is ignored
+static int ReadColumnVisibility(tTrack_spec* pTrack_spec, FILE* pF) {
+    tColumn_visibility* visibility;
+    int ncells;
+    int i;
+
+    if (ReadU32(pF) != PVS_FILE_MAGIC
+        || ReadU32(pF) != PVS_FILE_VERSION
+        || ReadU32(pF) != pTrack_spec->ncolumns_x
+        || ReadU32(pF) != pTrack_spec->ncolumns_z
+        || ReadU32(pF) != (tU32)pTrack_spec->face_grid.nfaces
+        || ReadScalar(pF) != pTrack_spec->column_size_x
+        || ReadScalar(pF) != pTrack_spec->column_size_z) {
+        return 0;
+    }
+    AllocateColumnVisibility(pTrack_spec);
+    visibility = &pTrack_spec->column_visibility;
+    ncells = pTrack_spec->ncolumns_x * pTrack_spec->ncolumns_z;
+    visibility->range = ReadScalar(pF);
+    for (i = 0; i < 2 * ncells; i++) {
+        visibility->eye_heights[i] = ReadScalar(pF);
+    }
+    if (fread(visibility->bits, visibility->row_bytes, ncells, pF) != (size_t)ncells) {
+        DisposeColumnVisibility(pTrack_spec);
+        return 0;
+    }
+    return 1;
+}
+
+// Added by dethrace
+// Pick up the .PVS beside the track actor, or bake one first when running with `--bake-pvs`.
+// Without one every column in the view frustum is drawn, as before
+void LoadColumnVisibility(tTrack_spec* pTrack_spec, char* pActor_path) {
+    tPath_name the_path;
+    FILE* f;
+    int old_allow_open_to_fail;
+    int loaded;
+    LOG_TRACE("(%p, \"%s\")", pTrack_spec, pActor_path);
+
+    DisposeColumnVisibility(pTrack_spec);
+    if (pTrack_spec->face_grid.cells == NULL) {
+        return;
+    }
+    ColumnVisibilityPath(the_path, pActor_path);
+    old_allow_open_to_fail = gAllow_open_to_fail;
+    AllowOpenToFail();
+    f = DRfopen(the_path, "rb");
+    gAllow_open_to_fail = old_allow_open_to_fail;
+    loaded = 0;
+    if (f != NULL) {
+        loaded = ReadColumnVisibility(pTrack_spec, f);
+        fclose(f);
+        if (!loaded) {
+            dr_dprintf("\"%s\" does not match the track, ignoring it", the_path);
+        }
+    }
+    if (!loaded && harness_game_config.bake_pvs) {
+        BakeColumnVisibility(pTrack_spec);
+        WriteColumnVisibility(pTrack_spec, the_path);
+    }
+}
+
+// Added by dethrace
+// The row of columns seen from where the camera is, or NULL when the camera is somewhere the .PVS does not cover:
+// outside the grid, above or below the heights baked, or looking further than the range baked
+static tU8* ColumnVisibilityRow(tTrack_spec* pTrack_spec, br_matrix34* pCamera_to_world, br_vector2* pFar_corners) {
+    tColumn_visibility* visibility;
+    br_scalar x;
+    br_scalar z;
+    br_scalar dx;
+    br_scalar dz;
+    int cell;
+    int i;
+
+    visibility = &pTrack_spec->column_visibility;
+    if (visibility->bits == NULL) {
+        return NULL;
+    }
+    x = (pCamera_to_world->m[3][0] - pTrack_spec->origin_x) / pTrack_spec->column_size_x;
+    z = (pCamera_to_world->m[3][2] - pTrack_spec->origin_z) / pTrack_spec->column_size_z;
+    if (x < 0.f || x >= pTrack_spec->ncolumns_x || z < 0.f || z >= pTrack_spec->ncolumns_z) {
+        return NULL;
+    }
+    cell = (int)z * pTrack_spec->ncolumns_x + (int)x;
+    if (pCamera_to_world->m[3][1] < visibility->eye_heights[2 * cell] || pCamera_to_world->m[3][1] > visibility->eye_heights[2 * cell + 1]) {
+        return NULL;
+    }
+    for (i = 0; i < 4; i++) {
+        dx = pFar_corners[i].v[0] - pCamera_to_world->m[3][0];
+        dz = pFar_corners[i].v[1] - pCamera_to_world->m[3][2];
+        if (dx * dx + dz * dz > visibility->range * visibility->range) {
+            return NULL;
+        }
+    }
+    return &visibility->bits[cell * visibility->row_bytes];
 }
 
 // IDA: void __usercall LollipopizeActor4(br_actor *pActor@<EAX>, br_matrix34 *pRef_to_world@<EDX>, br_actor *pCamera@<EBX>)
@@ -317,6 +1039,157 @@ br_uintptr_t LollipopizeChildren(br_actor* pActor, void* pArg) {
     return 0;
 }
 
+// Added by dethrace: columns that can appear in the view of the last non-blend RenderTrack, [z * ncolumns_x + x].
+// Only the cells inside its rectangle are up to date. The blend pass of the same view reuses them
+static tU8* gVisible_columns;
+static int gVisible_columns_count;
+
+// Added by dethrace
+void DisposeVisibleColumns(void) {
+
+    if (gVisible_columns != NULL) {
+        BrMemFree(gVisible_columns);
+        gVisible_columns = NULL;
+    }
+    gVisible_columns_count = 0;
+}
+
+// Added by dethrace
+static int ColumnVisible(tTrack_spec* pTrack_spec, int pColumn_x, int pColumn_z) {
+
+    return gVisible_columns == NULL || gVisible_columns[pColumn_z * pTrack_spec->ncolumns_x + pColumn_x];
+}
+
+// Added by dethrace
+static br_scalar HullCross(br_vector2* pO, br_vector2* pA, br_vector2* pB) {
+
+    return (pA->v[0] - pO->v[0]) * (pB->v[1] - pO->v[1]) - (pA->v[1] - pO->v[1]) * (pB->v[0] - pO->v[0]);
+}
+
+// Added by dethrace
+// Mark which columns of the rectangle can hold something on screen. Seen from above, the view frustum covers the convex
+// hull of the camera position and the four far plane corners. A column is kept when that hull touches its cell grown by
+// one column on each side, the same margin RenderTrack adds to its rectangle for geometry that overhangs its column.
+// Edge columns also hold everything beyond the grid, so they are treated as unbounded outwards
+static void MarkVisibleColumns(tTrack_spec* pTrack_spec, br_camera* pCamera, br_matrix34* pCamera_to_world, int pMin_x, int pMax_x, int pMin_z, int pMax_z) {
+    br_vector2 points[5];
+    br_vector2 far_corners[4];
+    br_vector2 hull[10];
+    br_vector2 temp;
+    br_vector3 corner;
+    br_vector3 corner_world;
+    br_vector2 hull_min;
+    br_vector2 hull_max;
+    br_vector2 cell_min;
+    br_vector2 cell_max;
+    br_vector2 probe;
+    tU8* seen_from_here;
+    br_scalar tan_fov_ish;
+    br_scalar dx;
+    br_scalar dz;
+    int number_of_hull_points;
+    int lower_count;
+    int visible;
+    int cell;
+    int x;
+    int z;
+    int i;
+    int j;
+
+    if (gVisible_columns_count != pTrack_spec->ncolumns_x * pTrack_spec->ncolumns_z) {
+        DisposeVisibleColumns();
+        gVisible_columns_count = pTrack_spec->ncolumns_x * pTrack_spec->ncolumns_z;
+        gVisible_columns = BrMemAllocate(gVisible_columns_count, kMem_visible_columns);
+    }
+
+    tan_fov_ish = sinf(BrAngleToRadian(pCamera->field_of_view / 2)) / cosf(BrAngleToRadian(pCamera->field_of_view / 2));
+    points[0].v[0] = pCamera_to_world->m[3][0];
+    points[0].v[1] = pCamera_to_world->m[3][2];
+    for (i = 0; i < 4; i++) {
+        corner.v[0] = pCamera->yon_z * gYon_factor * pCamera->aspect * tan_fov_ish * ((i & 1) ? -1.f : 1.f);
+        corner.v[1] = pCamera->yon_z * gYon_factor * tan_fov_ish * ((i & 2) ? -1.f : 1.f);
+        corner.v[2] = pCamera->yon_z * gYon_factor * -1.f;
+        BrMatrix34ApplyV(&corner_world, &corner, pCamera_to_world);
+        points[i + 1].v[0] = pCamera_to_world->m[3][0] + corner_world.v[0];
+        points[i + 1].v[1] = pCamera_to_world->m[3][2] + corner_world.v[2];
+        far_corners[i] = points[i + 1];
+    }
+    seen_from_here = ColumnVisibilityRow(pTrack_spec, pCamera_to_world, far_corners);
+
+    // monotone chain, counter clockwise
+    for (i = 1; i < 5; i++) {
+        temp = points[i];
+        for (j = i; j > 0 && (points[j - 1].v[0] > temp.v[0] || (points[j - 1].v[0] == temp.v[0] && points[j - 1].v[1] > temp.v[1])); j--) {
+            points[j] = points[j - 1];
+        }
+        points[j] = temp;
+    }
+    number_of_hull_points = 0;
+    for (i = 0; i < 5; i++) {
+        while (number_of_hull_points >= 2 && HullCross(&hull[number_of_hull_points - 2], &hull[number_of_hull_points - 1], &points[i]) <= 0.f) {
+            number_of_hull_points--;
+        }
+        hull[number_of_hull_points++] = points[i];
+    }
+    lower_count = number_of_hull_points + 1;
+    for (i = 3; i >= 0; i--) {
+        while (number_of_hull_points >= lower_count && HullCross(&hull[number_of_hull_points - 2], &hull[number_of_hull_points - 1], &points[i]) <= 0.f) {
+            number_of_hull_points--;
+        }
+        hull[number_of_hull_points++] = points[i];
+    }
+    number_of_hull_points--;
+
+    hull_min = points[0];
+    hull_max = points[0];
+    for (i = 1; i < 5; i++) {
+        hull_min.v[0] = MIN(hull_min.v[0], points[i].v[0]);
+        hull_min.v[1] = MIN(hull_min.v[1], points[i].v[1]);
+        hull_max.v[0] = MAX(hull_max.v[0], points[i].v[0]);
+        hull_max.v[1] = MAX(hull_max.v[1], points[i].v[1]);
+    }
+
+    for (z = pMin_z; z <= pMax_z; z++) {
+        for (x = pMin_x; x <= pMax_x; x++) {
+            cell_min.v[0] = pTrack_spec->origin_x + (x - 1) * pTrack_spec->column_size_x;
+            cell_max.v[0] = pTrack_spec->origin_x + (x + 2) * pTrack_spec->column_size_x;
+            cell_min.v[1] = pTrack_spec->origin_z + (z - 1) * pTrack_spec->column_size_z;
+            cell_max.v[1] = pTrack_spec->origin_z + (z + 2) * pTrack_spec->column_size_z;
+            if (x == 0) {
+                cell_min.v[0] = hull_min.v[0];
+            }
+            if (x == pTrack_spec->ncolumns_x - 1) {
+                cell_max.v[0] = hull_max.v[0];
+            }
+            if (z == 0) {
+                cell_min.v[1] = hull_min.v[1];
+            }
+            if (z == pTrack_spec->ncolumns_z - 1) {
+                cell_max.v[1] = hull_max.v[1];
+            }
+            visible = cell_min.v[0] <= hull_max.v[0] && cell_max.v[0] >= hull_min.v[0]
+                && cell_min.v[1] <= hull_max.v[1] && cell_max.v[1] >= hull_min.v[1];
+            // a degenerate hull has no edges to separate along, the bounding box test is all there is
+            for (i = 0; visible && number_of_hull_points >= 3 && i < number_of_hull_points; i++) {
+                // the corner of the cell furthest inside this edge
+                dx = hull[(i + 1) % number_of_hull_points].v[0] - hull[i].v[0];
+                dz = hull[(i + 1) % number_of_hull_points].v[1] - hull[i].v[1];
+                probe.v[0] = dz < 0.f ? cell_max.v[0] : cell_min.v[0];
+                probe.v[1] = dx > 0.f ? cell_max.v[1] : cell_min.v[1];
+                if (dx * (probe.v[1] - hull[i].v[1]) - dz * (probe.v[0] - hull[i].v[0]) < 0.f) {
+                    visible = 0;
+                }
+            }
+            cell = z * pTrack_spec->ncolumns_x + x;
+            // and the .PVS must not know it to be hidden behind something
+            if (visible && seen_from_here != NULL) {
+                visible = (seen_from_here[cell >> 3] >> (cell & 7)) & 1;
+            }
+            gVisible_columns[cell] = visible;
+        }
+    }
+}
+
 // IDA: void __usercall DrawColumns(int pDraw_blends@<EAX>, tTrack_spec *pTrack_spec@<EDX>, int pMin_x@<EBX>, int pMax_x@<ECX>, int pMin_z, int pMax_z, br_matrix34 *pCamera_to_world)
 void DrawColumns(int pDraw_blends, tTrack_spec* pTrack_spec, int pMin_x, int pMax_x, int pMin_z, int pMax_z, br_matrix34* pCamera_to_world) {
     tU8 column_x;
@@ -341,6 +1214,10 @@ void DrawColumns(int pDraw_blends, tTrack_spec* pTrack_spec, int pMin_x, int pMa
                 } else {
                     column_z2 = column_z;
                 }
+                // Added by dethrace
+                if (!ColumnVisible(pTrack_spec, column_x2, column_z2)) {
+                    continue;
+                }
                 if (pDraw_blends) {
                     blended_polys = pTrack_spec->blends[column_z2][column_x2];
                     if (blended_polys) {
@@ -373,6 +1250,10 @@ void DrawColumns(int pDraw_blends, tTrack_spec* pTrack_spec, int pMin_x, int pMa
                 } else {
                     column_z2 = column_z;
                 }
+                // Added by dethrace
+                if (!ColumnVisible(pTrack_spec, column_x2, column_z2)) {
+                    continue;
+                }
                 if (pDraw_blends) {
                     blended_polys = pTrack_spec->blends[column_z2][column_x2];
                     if (blended_polys) {
@@ -492,6 +1373,8 @@ void RenderTrack(br_actor* pWorld, tTrack_spec* pTrack_spec, br_actor* pCamera,
             if (pTrack_spec->ncolumns_z - 1 > max_z) {
                 max_z++;
             }
+            // Added by dethrace
+            MarkVisibleColumns(pTrack_spec, camera, pCamera_to_world, min_x, max_x, min_z, max_z);
             DrawColumns(0, pTrack_spec, min_x, max_x, min_z, max_z, pCamera_to_world);
         }
     } else {
@@ -25,6 +25,18 @@ void ProcessModels(tTrack_spec* pTrack_spec);
 
 void ExtractColumns(tTrack_spec* pTrack_spec);
 
+void BuildFaceGrid(tTrack_spec* pTrack_spec);
+
+void RefreshFaceGrid(tTrack_spec* pTrack_spec);
+
+void DisposeFaceGrid(tTrack_spec* pTrack_spec);
+
+void DisposeVisibleColumns(void);
+
+void DisposeColumnVisibility(tTrack_spec* pTrack_spec);
+
+void LoadColumnVisibility(tTrack_spec* pTrack_spec, char* pActor_path);
+
 void LollipopizeActor4(br_actor* pActor, br_matrix34* pRef_to_world, br_actor* pCamera);
 
 /*br_uint_32*/ br_uintptr_t LollipopizeChildren(br_actor* pActor, void* pArg);
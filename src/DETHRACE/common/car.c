@@ -14,7 +14,10 @@
 #include "globvrme.h"
 #include "globvrpb.h"
 #include "graphics.h"
+#include "harness/compiler.h"
 #include "harness/config.h"
+#include "harness/jobs.h"
+#include "harness/profile.h"
 #include "harness/trace.h"
 #include "netgame.h"
 #include "network.h"
@@ -34,7 +37,51 @@
 #include "utility.h"
 #include "world.h"
 #include <math.h>
+#include <setjmp.h>
 #include <stdlib.h>
+#include <string.h>
+
+// Added by dethrace: per-car face caches start this big and double when a box query fills them, up to the size of the
+// shared list they replace. A box with more faces than that is cut short exactly as it was, so collisions are unchanged
+#define FACE_CACHE_INITIAL_SIZE 32
+#define FACE_CACHE_MAX_SIZE 150
+// Added by dethrace: face caches are carved out of arena blocks of at least this many faces
+#define FACE_ARENA_BLOCK_SIZE 1024
+
+// Added by dethrace
+typedef struct tFace_arena_block {
+    struct tFace_arena_block* next;
+    int used;
+    int size;
+    tFace_ref* faces;
+} tFace_arena_block;
+
+// Added by dethrace
+typedef enum tCar_job_state {
+    eCar_job_serial,    // moved on the main thread while the moves are committed
+    eCar_job_pending,   // waiting for a job thread
+    eCar_job_moved,     // moved speculatively, waiting to be committed
+    eCar_job_abandoned, // speculative move hit a side effect and was undone, moved again on the main thread
+} tCar_job_state;
+
+// Added by dethrace: one car's speculative move during a physics step, see MoveCarsInParallel
+typedef struct tCar_job {
+    tCar_spec* car;
+    tCar_job_state state;
+    jmp_buf abandon;
+    tCar_spec backup;
+    br_matrix34 backup_mat;
+    // a speculative box query fills this instead of the car's cache, they are swapped on commit
+    tFace_ref* spare_faces;
+    int spare_faces_allocated;
+    // changes to statics shared between cars, applied in car order on commit
+    int skid_marks;
+    int stop_timer_pending;
+    br_scalar stop_timer_dt;
+    int oldk_written;
+    int oldk;
+    int material_index;
+} tCar_job;
 
 int gDoing_physics = 0;
 br_scalar gDt = 0.f;
@@ -80,7 +127,7 @@ tU32 gOn_me_wheels_start = 0;
 int gWoz_upside_down_at_all = 0;
 tS3_sound_tag gSkid_tag[2] = { 0, 0 };
 tCar_spec* gLast_car_to_skid[2] = { NULL, NULL };
-int gEliminate_faces = 0;
+HARNESS_THREAD_LOCAL int gEliminate_faces = 0; // Added by dethrace: thread local
 br_vector3 gZero_v__car = { { 0 } }; // suffix added to avoid duplicate symbol
 tU32 gSwitch_time = 0;
 tSave_camera gSave_camera[2];
@@ -94,7 +141,6 @@ float gOffensive_powerup_factor[6] = { 1.0f, 1.5f, 2.0f, 3.0f, 5.0f, 10.0f };
 float gEngine_powerup_factor[6] = { 1.3f, 1.9f, 2.5f, 3.2f, 4.0f, 10.0f };
 br_angle gPanning_camera_angle;
 br_scalar gPanning_camera_height;
-int gFace_count;
 float gCar_simplification_factor[2][5] = {
     { 10.0f, 3.0f, 1.5f, 0.75f, 0.0f },
     { 10.0f, 5.0f, 2.5f, 1.5f, 0.0f }
@@ -102,8 +148,16 @@ float gCar_simplification_factor[2][5] = {
 int gCar_simplification_level = 0;
 int gNum_active_non_cars = 0;
 int gCamera_has_collided = 0;
-tFace_ref gFace_list__car[150]; // suffix added to avoid duplicate symbol
 tNon_car_spec* gActive_non_car_list[50];
+static tFace_arena_block* gFace_arena; // Added by dethrace
+static tCar_job* gCar_jobs;            // Added by dethrace
+// Added by dethrace: the job a thread is moving a car for, NULL on the main thread outside MoveCarsInParallel
+static HARNESS_THREAD_LOCAL tCar_job* gCar_job;
+// Added by dethrace: counts changes to the track that a speculative move may have missed
+static int gWorld_changes;
+// Added by dethrace: CalcForce's and CollCheck's statics, moved out so CommitCarJob can update them
+static br_scalar gStop_timer;
+static int gCollision_oldk;
 int gOver_shoot;
 br_scalar gMin_world_y;
 br_scalar gAccel;
@@ -111,7 +165,7 @@ br_vector3 gAverage_grid_position;
 br_actor* gPed_actor;
 int gCollision_count;
 int gCamera_frozen;
-int gMaterial_index;
+HARNESS_THREAD_LOCAL int gMaterial_index; // Added by dethrace: thread local
 int gInTheSea;
 int gCamera_mode;
 br_scalar gOur_yaw__car;            // suffix added to avoid duplicate symbol
@@ -126,6 +180,7 @@ void DamageUnit(tCar_spec* pCar, int pUnit_type, int pDamage_amount) {
     tDamage_unit* the_damage;
     LOG_TRACE("(%p, %d, %d)", pCar, pUnit_type, pDamage_amount);
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     if (pDamage_amount > 0) {
         the_damage = &pCar->damage_units[pUnit_type];
         the_damage->damage_level += pDamage_amount;
@@ -376,6 +431,8 @@ void InitialiseCar2(tCar_spec* pCar, int pClear_disabled_flag) {
     }
     PossibleService();
     pCar->box_face_ref = gFace_num__car - 2;
+    // Added by dethrace
+    ResetFaceCache((tCollision_info*)pCar);
     pCar->doing_nothing_flag = 0;
     pCar->end_steering_damage_effect = 0;
     pCar->end_trans_damage_effect = 0;
@@ -427,6 +484,8 @@ void InitialiseCarsEtc(tRace_info* pThe_race) {
     BrActorToBounds(&bnds, gProgram_state.track_spec.the_actor);
     gMin_world_y = bnds.min.v[1];
     gNum_active_non_cars = 0;
+    // Added by dethrace: every car and non-car gets a fresh face cache below
+    DisposeFaceCaches();
     for (cat = eVehicle_self; cat <= eVehicle_not_really; cat++) {
         if (cat == eVehicle_self) {
             car_count = 1;
@@ -584,6 +643,8 @@ void InitialiseNonCar(tNon_car_spec* non_car) {
     c = &non_car->collision_info;
     BrMatrix34Copy(&c->oldmat, &c->car_master_actor->t.t.mat);
     non_car->collision_info.box_face_ref = gFace_num__car - 2;
+    // Added by dethrace: DoPullActorFromWorld may have copied another non-car's cache pointer
+    ResetFaceCache(c);
     non_car->collision_info.doing_nothing_flag = 1;
     non_car->collision_info.disabled = 0;
     BrVector3SetFloat(&c->v, 0.0f, 0.0f, 0.0f);
@@ -608,6 +669,62 @@ void InitialiseNonCar(tNon_car_spec* non_car) {
     c->last_car_car_collision = 1;
 }
 
+// Added by dethrace
+void ResetFaceCache(tCollision_info* c) {
+    LOG_TRACE("(%p)", c);
+
+    c->box_faces = NULL;
+    c->box_faces_allocated = 0;
+    c->box_face_start = 0;
+    c->box_face_end = 0;
+}
+
+// Added by dethrace: frees every face cache. Cars and non-cars must be reset with ResetFaceCache before their next query
+void DisposeFaceCaches(void) {
+    tFace_arena_block* block;
+    int i;
+    LOG_TRACE("()");
+
+    while (gFace_arena != NULL) {
+        block = gFace_arena;
+        gFace_arena = block->next;
+        BrMemFree(block->faces);
+        BrMemFree(block);
+    }
+    if (gCar_jobs != NULL) {
+        for (i = 0; i < COUNT_OF(gActive_car_list); i++) {
+            gCar_jobs[i].spare_faces = NULL;
+            gCar_jobs[i].spare_faces_allocated = 0;
+        }
+    }
+}
+
+// Added by dethrace
+static tFace_ref* AllocateFaces(int pSize) {
+    tFace_arena_block* block;
+    tFace_ref* faces;
+
+    block = gFace_arena;
+    if (block == NULL || block->size - block->used < pSize) {
+        block = BrMemAllocate(sizeof(tFace_arena_block), kMem_face_cache);
+        block->size = MAX(pSize, FACE_ARENA_BLOCK_SIZE);
+        block->used = 0;
+        block->faces = BrMemAllocate(sizeof(tFace_ref) * block->size, kMem_face_cache);
+        block->next = gFace_arena;
+        gFace_arena = block;
+    }
+    faces = &block->faces[block->used];
+    block->used += pSize;
+    return faces;
+}
+
+// Added by dethrace: a cache outgrown by its car is not reused, it is released with the rest of the arena
+static void GrowFaceCache(tCollision_info* c, int pSize) {
+    CarPhysicsSideEffect(0);
+    c->box_faces = AllocateFaces(pSize);
+    c->box_faces_allocated = pSize;
+}
+
 // IDA: void __usercall GetFacesInBox(tCollision_info *c@<EAX>)
 void GetFacesInBox(tCollision_info* c) {
     tBounds bnds;
@@ -643,7 +760,7 @@ void GetFacesInBox(tCollision_info* c) {
     }
     GetNewBoundingBox(&c->bounds_world_space, &bnds.original_bounds, &mat);
     c->bounds_ws_type = eBounds_ws;
-    if ((c->box_face_ref != gFace_num__car && (c->box_face_ref != gFace_num__car - 1 || c->box_face_start <= gFace_count))
+    if (c->box_face_ref != gFace_num__car
         || (BrMatrix34Mul(&mat5, &mat, &c->last_box_inv_mat),
             GetNewBoundingBox(&new_in_old, &bnds.original_bounds, &mat5),
             c->last_box.max.v[0] <= new_in_old.max.v[0])
@@ -669,13 +786,23 @@ void GetFacesInBox(tCollision_info* c) {
         c->last_box = bnds.original_bounds;
         BrMatrix34Copy(&c->last_box_inv_mat, &mat3);
         bnds.mat = &mat;
-        c->box_face_start = gFace_count;
-        gPling_face = NULL;
-        gFace_count += FindFacesInBox(&bnds, &gFace_list__car[gFace_count], COUNT_OF(gFace_list__car) - gFace_count);
-        if (gFace_count >= COUNT_OF(gFace_list__car)) {
+        // Added by dethrace: each car queries into its own cache instead of a shared list, so one car
+        // filling up no longer forces every other car to query again
+        if (c->box_faces == NULL) {
+            GrowFaceCache(c, FACE_CACHE_INITIAL_SIZE);
+        }
+        // Added by dethrace: a speculative move leaves the car's cache alone in case it is abandoned
+        if (gCar_job != NULL) {
+            c->box_faces = gCar_job->spare_faces;
+        }
+        for (;;) {
+            gPling_face = NULL;
             c->box_face_start = 0;
-            gFace_count = FindFacesInBox(&bnds, gFace_list__car, COUNT_OF(gFace_list__car));
-            gFace_num__car++;
+            c->box_face_end = FindFacesInBox(&bnds, c->box_faces, c->box_faces_allocated);
+            if (c->box_face_end < c->box_faces_allocated || c->box_faces_allocated >= FACE_CACHE_MAX_SIZE) {
+                break;
+            }
+            GrowFaceCache(c, MIN(2 * c->box_faces_allocated, FACE_CACHE_MAX_SIZE));
         }
         old_d = c->water_d;
         if (c->driver == eDriver_local_human
@@ -720,7 +847,6 @@ void GetFacesInBox(tCollision_info* c) {
             AddSplashToPipingSession(c);
             EndPipingSession();
         }
-        c->box_face_end = gFace_count;
         c->box_face_ref = gFace_num__car;
     }
 }
@@ -1150,6 +1276,172 @@ void GetNetPos(tCar_spec* pCar) {
     pCar->last_car_car_collision = pCar->message.cc_coll_time;
 }
 
+// Added by dethrace: called on entry by anything that reaches beyond the car being moved (sounds, sparks, damage,
+// random numbers, the track actors). A speculative move is abandoned, see MoveCarsInParallel
+void CarPhysicsSideEffect(int pChanges_world) {
+    if (gCar_job != NULL) {
+        longjmp(gCar_job->abandon, 1);
+    }
+    if (pChanges_world) {
+        gWorld_changes++;
+    }
+}
+
+// Added by dethrace: one car's share of a mechanics step, the body of ApplyPhysicsToCars' car loop
+static void MoveCar(tCar_spec* car) {
+    int dam_index;
+    tCollision_info* car_info;
+
+    car->dt = -1.f;
+    if (car->message.type == NETMSGID_MECHANICS && car->message.time >= gLast_mechanics_time && car->message.time <= gLast_mechanics_time + harness_game_config.physics_step_time) {
+        // time between car message and next mechanics
+        car->dt = (gLast_mechanics_time + harness_game_config.physics_step_time - car->message.time) / 1000.0f;
+        // if the time between car message and next mechanics is about equal to timestep
+        if (car->dt >= gDt - 0.0001f) {
+            GetNetPos(car);
+        } else if (gNet_mode == eNet_mode_host) {
+            car->dt = -1.f;
+        } else {
+            for (dam_index = 0; dam_index < COUNT_OF(car->damage_units); dam_index++) {
+                if (car->damage_units[dam_index].damage_level < car->message.damage[dam_index]) {
+                    car->dt = -1.f;
+                    break;
+                }
+            }
+            if (car->dt >= 0.f) {
+                GetNetPos(car);
+            }
+        }
+    }
+    if (!car->disabled
+        && (!car->doing_nothing_flag || (car->driver >= eDriver_net_human && (!gPalette_fade_time || car->driver != eDriver_local_human)))) {
+        if (car->box_face_ref != gFace_num__car) {
+            car_info = (tCollision_info*)car;
+            GetFacesInBox(car_info);
+        }
+        if (car->dt != 0.f) {
+            MoveAndCollideCar(car, gDt);
+        }
+    }
+}
+
+// Added by dethrace: the local player's car drives the camera and the sea effects, and a pending network
+// message may move the car to a position that depends on the cars before it
+static int CanMoveCarInParallel(tCar_spec* car) {
+    return car->driver != eDriver_local_human
+        && car->message.type != NETMSGID_MECHANICS
+        && car->box_faces != NULL;
+}
+
+// Added by dethrace
+static void MoveCarJob(void* pContext, int pIndex) {
+    tCar_job* job;
+    tCar_spec* car;
+
+    job = &((tCar_job*)pContext)[pIndex];
+    if (job->state != eCar_job_pending) {
+        return;
+    }
+    PROFILE_ZONE_BEGIN(eProfile_zone_car_job);
+    car = job->car;
+    memcpy(&job->backup, car, sizeof(tCar_spec));
+    BrMatrix34Copy(&job->backup_mat, &car->car_master_actor->t.t.mat);
+    job->skid_marks = 0;
+    job->stop_timer_pending = 0;
+    job->oldk_written = 0;
+    gEliminate_faces = 0;
+    gMaterial_index = -1;
+    if (setjmp(job->abandon) == 0) {
+        gCar_job = job;
+        MoveCar(car);
+        job->state = eCar_job_moved;
+    } else {
+        memcpy(car, &job->backup, sizeof(tCar_spec));
+        BrMatrix34Copy(&car->car_master_actor->t.t.mat, &job->backup_mat);
+        job->state = eCar_job_abandoned;
+        // the move may have been abandoned in the middle of a box pick
+        gPick_blend = NULL;
+    }
+    gCar_job = NULL;
+    job->material_index = gMaterial_index;
+    PROFILE_ZONE_END(eProfile_zone_car_job);
+}
+
+// Added by dethrace: apply what a speculative move left for the main thread, exactly as the serial loop would have
+static void CommitCarJob(tCar_job* job) {
+    tFace_ref* faces;
+    int wheel;
+
+    if (job->car->box_faces != job->backup.box_faces) {
+        faces = job->spare_faces;
+        job->spare_faces = job->backup.box_faces;
+        job->spare_faces_allocated = job->backup.box_faces_allocated;
+        job->car->box_faces = faces;
+    }
+    if (job->stop_timer_pending) {
+        gStop_timer = job->stop_timer_dt + gStop_timer;
+        if (gStop_timer > 1.0) {
+            gStop_timer = 100.0;
+        }
+    }
+    if (job->oldk_written) {
+        gCollision_oldk = job->oldk;
+    }
+    if (job->material_index >= 0) {
+        gMaterial_index = job->material_index;
+    }
+    for (wheel = 0; wheel < job->skid_marks; wheel++) {
+        SkidMark(job->car, wheel);
+    }
+}
+
+// Added by dethrace: moves every active car as ApplyPhysicsToCars' car loop does, with results identical to it.
+// The job threads move the cars speculatively: a move only touches its own car until it would do anything else
+// (CarPhysicsSideEffect), when it is undone and left for the main thread. The main thread then walks the cars in
+// order, committing each speculative move or making the move itself. A move that ran alongside one that changed
+// the track (knocking a non-car loose) may have seen stale actors, so after such a change the remaining cars are
+// all moved again on the main thread
+static void MoveCarsInParallel(void) {
+    int i;
+    int world_changes;
+    int material_index;
+    tCar_job* job;
+    tCar_spec* car;
+
+    if (gCar_jobs == NULL) {
+        gCar_jobs = BrMemAllocate(sizeof(tCar_job) * COUNT_OF(gActive_car_list), kMem_car_jobs);
+        memset(gCar_jobs, 0, sizeof(tCar_job) * COUNT_OF(gActive_car_list));
+    }
+    for (i = 0; i < gNum_active_cars; i++) {
+        job = &gCar_jobs[i];
+        job->car = gActive_car_list[i];
+        job->state = CanMoveCarInParallel(job->car) ? eCar_job_pending : eCar_job_serial;
+        if (job->state == eCar_job_pending && job->spare_faces_allocated < job->car->box_faces_allocated) {
+            job->spare_faces = AllocateFaces(job->car->box_faces_allocated);
+            job->spare_faces_allocated = job->car->box_faces_allocated;
+        }
+    }
+    world_changes = gWorld_changes;
+    // the main thread takes jobs too, which must not leave their collision material behind
+    material_index = gMaterial_index;
+    Harness_Jobs_ParallelFor(MoveCarJob, gCar_jobs, gNum_active_cars);
+    gMaterial_index = material_index;
+    for (i = 0; i < gNum_active_cars; i++) {
+        job = &gCar_jobs[i];
+        car = job->car;
+        if (job->state == eCar_job_moved && gWorld_changes != world_changes) {
+            memcpy(car, &job->backup, sizeof(tCar_spec));
+            BrMatrix34Copy(&car->car_master_actor->t.t.mat, &job->backup_mat);
+            job->state = eCar_job_abandoned;
+        }
+        if (job->state == eCar_job_moved) {
+            CommitCarJob(job);
+        } else {
+            MoveCar(car);
+        }
+    }
+}
+
 // IDA: void __usercall ApplyPhysicsToCars(tU32 last_frame_time@<EAX>, tU32 pTime_difference@<EDX>)
 void ApplyPhysicsToCars(tU32 last_frame_time, tU32 pTime_difference) {
     br_vector3 minus_k;
@@ -1195,39 +1487,12 @@ void ApplyPhysicsToCars(tU32 last_frame_time, tU32 pTime_difference) {
         if (&gProgram_state.current_car != gCar_to_view) {
             BrVector3Copy(&gCar_to_view->old_v, &gCar_to_view->v);
         }
-        for (i = 0; i < gNum_active_cars; i++) {
-            car = gActive_car_list[i];
-            car->dt = -1.f;
-            if (car->message.type == NETMSGID_MECHANICS && car->message.time >= gLast_mechanics_time && car->message.time <= gLast_mechanics_time + harness_game_config.physics_step_time) {
-                // time between car message and next mechanics
-                car->dt = (gLast_mechanics_time + harness_game_config.physics_step_time - car->message.time) / 1000.0f;
-                // if the time between car message and next mechanics is about equal to timestep
-                if (car->dt >= gDt - 0.0001f) {
-                    GetNetPos(car);
-                } else if (gNet_mode == eNet_mode_host) {
-                    car->dt = -1.f;
-                } else {
-                    for (dam_index = 0; dam_index < COUNT_OF(car->damage_units); dam_index++) {
-                        if (car->damage_units[dam_index].damage_level < car->message.damage[dam_index]) {
-                            car->dt = -1.f;
-                            break;
-                        }
-                    }
-                    if (car->dt >= 0.f) {
-                        GetNetPos(car);
-                    }
-                }
-            }
-            if (!car->disabled
-                && (!car->doing_nothing_flag || (car->driver >= eDriver_net_human && (!gPalette_fade_time || car->driver != eDriver_local_human)))) {
-                if (car->box_face_ref != gFace_num__car
-                    && (car->box_face_ref != gFace_num__car - 1 || car->box_face_start <= gFace_count)) {
-                    car_info = (tCollision_info*)car;
-                    GetFacesInBox(car_info);
-                }
-                if (car->dt != 0.f) {
-                    MoveAndCollideCar(car, gDt);
-                }
+        // Added by dethrace: the per car work is moved to MoveCar so the job threads can share it
+        if (Harness_Jobs_ThreadCount() > 1 && gNum_active_cars > 1) {
+            MoveCarsInParallel();
+        } else {
+            for (i = 0; i < gNum_active_cars; i++) {
+                MoveCar(gActive_car_list[i]);
             }
         }
         for (i = 0; i < gNum_active_non_cars; i++) {
@@ -1238,9 +1503,7 @@ void ApplyPhysicsToCars(tU32 last_frame_time, tU32 pTime_difference) {
                     non_car->collision_info.dt = (gLast_mechanics_time + harness_game_config.physics_step_time - non_car->collision_info.message.time) / 1000.0f;
                     GetNetPos((tCar_spec*)non_car);
                 }
-                if (non_car->collision_info.box_face_ref != gFace_num__car
-                    && (non_car->collision_info.box_face_ref != gFace_num__car - 1
-                        || non_car->collision_info.box_face_start <= gFace_count)) {
+                if (non_car->collision_info.box_face_ref != gFace_num__car) {
                     GetFacesInBox(&non_car->collision_info);
                 }
                 if (non_car->collision_info.dt != 0.0f) {
@@ -1426,6 +1689,11 @@ void MoveAndCollideCar(tCar_spec* car, br_scalar dt) {
         CollideCarWithWall(car_info, dt);
         BrMatrix34ApplyP(&car->pos, &car->cmpos, &car->car_master_actor->t.t.mat);
         BrVector3InvScale(&car->pos, &car->pos, WORLD_SCALE);
+        // Added by dethrace: skid marks are shared between cars, a speculative move leaves them to CommitCarJob
+        if (gCar_job != NULL) {
+            gCar_job->skid_marks = 4;
+            return;
+        }
         for (wheel = 0; wheel < 4; wheel++) {
             SkidMark(car, wheel);
         }
@@ -2060,8 +2328,7 @@ void CalcForce(tCar_spec* c, br_scalar dt) {
     br_scalar rr_oil_factor;
     br_matrix34* mat;
     tMaterial_modifiers* mat_list;
-    static br_scalar stop_timer;
-    static br_scalar slide_dist;
+    static HARNESS_THREAD_LOCAL br_scalar slide_dist; // Added by dethrace: thread local, it is only ever written
     tDamage_type dam;
     br_scalar v;
     tSpecial_volume* vol;
@@ -2604,19 +2871,26 @@ void CalcForce(tCar_spec* c, br_scalar dt) {
             friction_number = BrVector3Length(&b);
         }
         if (c->M > friction_number || (c->keys.brake && normnum >= 3)) {
-            if (stop_timer == 100.0) {
-                stop_timer = 0.0;
+            // Added by dethrace: whether the car is held still depends on the cars moved before it
+            CarPhysicsSideEffect(0);
+            if (gStop_timer == 100.0) {
+                gStop_timer = 0.0;
             }
-            if (stop_timer > 0.5) {
+            if (gStop_timer > 0.5) {
                 BrVector3SetFloat(&c->v, 0.0, 0.0, 0.0);
                 BrVector3SetFloat(&c->omega, 0.0, 0.0, 0.0);
-                stop_timer = 0.5;
+                gStop_timer = 0.5;
             }
         }
     }
-    stop_timer = dt + stop_timer;
-    if (stop_timer > 1.0) {
-        stop_timer = 100.0;
+    if (gCar_job != NULL) {
+        gCar_job->stop_timer_pending = 1;
+        gCar_job->stop_timer_dt = dt;
+    } else {
+        gStop_timer = dt + gStop_timer;
+        if (gStop_timer > 1.0) {
+            gStop_timer = 100.0;
+        }
     }
     AddDrag(c, dt);
     if (c->driver >= eDriver_net_human) {
@@ -2758,7 +3032,6 @@ int CollCheck(tCollision_info* c, br_scalar dt) {
     int k;
     int material;
     int noise_defeat;
-    static int oldk;
     br_scalar min;
     br_scalar max;
     br_vector3 edges[3];
@@ -2810,7 +3083,7 @@ int CollCheck(tCollision_info* c, br_scalar dt) {
         edges[j].v[2] = (bnds.max.v[j] - bnds.min.v[j]) * mat->m[j][2];
     }
     for (i = 0; i < 50 && i < c->box_face_end - c->box_face_start; i++) {
-        f_ref = &gFace_list__car[c->box_face_start + i];
+        f_ref = &c->box_faces[c->box_face_start + i];
         BrVector3Sub(&bb, &aa, &f_ref->v[0]);
         max = BrVector3Dot(&bb, &f_ref->normal);
         min = max;
@@ -3005,7 +3278,12 @@ int CollCheck(tCollision_info* c, br_scalar dt) {
             BrVector3Cross(&tv, &c->omega, &dir);
             BrVector3Accumulate(&tv, &c->velocity_car_space);
             batwick_length = BrVector3Length(&tv);
-            if (!c->collision_flag || (c->collision_flag == 1 && oldk < k)) {
+            // Added by dethrace: a speculative move keeps oldk to itself until it is committed, and cannot use one
+            // left behind by an earlier car
+            if (gCar_job != NULL && c->collision_flag == 1 && !gCar_job->oldk_written) {
+                CarPhysicsSideEffect(0);
+            }
+            if (!c->collision_flag || (c->collision_flag == 1 && (gCar_job != NULL ? gCar_job->oldk : gCollision_oldk) < k)) {
                 for (i = 0; i < k; i++) {
                     BrVector3Cross(&vel, &c->omega, &r[i]);
                     BrVector3Accumulate(&vel, &c->velocity_car_space);
@@ -3014,7 +3292,12 @@ int CollCheck(tCollision_info* c, br_scalar dt) {
                     BrVector3Accumulate(&c->velocity_car_space, &max_friction);
                 }
             }
-            oldk = k;
+            if (gCar_job != NULL) {
+                gCar_job->oldk = k;
+                gCar_job->oldk_written = 1;
+            } else {
+                gCollision_oldk = k;
+            }
             BrMatrix34ApplyP(&pos, &dir, &c->car_master_actor->t.t.mat);
             BrVector3InvScale(&pos, &pos, WORLD_SCALE);
             noise_defeat = 0;
@@ -3231,6 +3514,7 @@ void ScrapeNoise(br_scalar vel, br_vector3* position, int material) {
     br_vector3 position_in_br;
     LOG_TRACE("(%f, %p, %d)", vel, position, material);
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     vol = vel * 7.0;
     if (gCurrent_race.material_modifiers[material].scrape_noise_index == -1) {
         return;
@@ -3266,6 +3550,7 @@ void SkidNoise(tCar_spec* pC, int pWheel_num, br_scalar pV, int material) {
     int i;
     LOG_TRACE("(%p, %d, %f, %d)", pC, pWheel_num, pV, material);
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     i = IRandomBetween(0, 1);
     if (gCurrent_race.material_modifiers[material].tyre_noise_index == -1) {
         return;
@@ -3311,6 +3596,7 @@ void SkidNoise(tCar_spec* pC, int pWheel_num, br_scalar pV, int material) {
 void StopSkid(tCar_spec* pC) {
     LOG_TRACE("(%p)", pC);
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     if (gLast_car_to_skid[0] == pC) {
         DRS3StopSound(gSkid_tag[0]);
     }
@@ -3327,6 +3613,7 @@ void CrashNoise(br_vector3* pForce, br_vector3* position, int material) {
     br_vector3 velocity;
     LOG_TRACE("(%p, %p, %d)", pForce, position, material);
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     vol = 60.f * BrVector3Length(pForce);
     if (gCurrent_race.material_modifiers[material].crash_noise_index != -1) {
         if (vol >= 256) {
@@ -3357,6 +3644,7 @@ void CrushAndDamageCar(tCar_spec* c, br_vector3* pPosition, br_vector3* pForce_c
     br_scalar fudge_multiplier;
     LOG_TRACE("(%p, %p, %p, %p)", c, pPosition, pForce_car_space, car2);
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     if (car2 != NULL) {
         car2->who_last_hit_me = c;
         c->who_last_hit_me = car2;
@@ -3569,7 +3857,7 @@ void CrushBoundingBox(tCar_spec* c, int crush_only) {
 
 // IDA: void __cdecl AddCollPoint(br_scalar dist, br_vector3 *p, br_vector3 *norm, br_vector3 *r, br_vector3 *n, br_vector3 *dir, int num, tCollision_info *c)
 void AddCollPoint(br_scalar dist, br_vector3* p, br_vector3* norm, br_vector3* r, br_vector3* n, br_vector3* dir, int num, tCollision_info* c) {
-    static br_scalar d[4];
+    static HARNESS_THREAD_LOCAL br_scalar d[4]; // Added by dethrace: thread local
     int i;
     int furthest;
     LOG_TRACE("(%f, %p, %p, %p, %p, %p, %d, %p)", dist, p, norm, r, n, dir, num, c);
@@ -3767,14 +4055,14 @@ void MultiFindFloorInBoxBU(int pNum_rays, br_vector3* a, br_vector3* b, br_vecto
     LOG_TRACE("(%d, %p, %p, %p, %p, %p, %p)", pNum_rays, a, b, nor, d, c, mat_ref);
 
     for (i = c->box_face_start; i < c->box_face_end; i++) {
-        face_ref = &gFace_list__car[i];
+        face_ref = &c->box_faces[i];
         if (!gEliminate_faces || (face_ref->flags & 0x80) == 0x0) {
             MultiRayCheckSingleFace(pNum_rays, face_ref, a, b, &nor2, dist);
             for (j = 0; j < pNum_rays; ++j) {
                 if (d[j] > dist[j]) {
                     d[j] = dist[j];
                     nor[j] = nor2;
-                    l = *gFace_list__car[i].material->identifier - 47;
+                    l = *c->box_faces[i].material->identifier - 47;
                     if (l >= 0 && l < 11) {
                         mat_ref[j] = l;
                     }
@@ -3825,7 +4113,7 @@ int FindFloorInBoxBU(br_vector3* a, br_vector3* b, br_vector3* nor, br_scalar* d
 #endif
     *d = 2.0;
     for (i = c->box_face_start; i < c->box_face_end; i++) {
-        face_ref = &gFace_list__car[i];
+        face_ref = &c->box_faces[i];
         if (!gEliminate_faces || SLOBYTE(face_ref->flags) >= 0) {
             CheckSingleFace(face_ref, a, b, &nor2, &dist);
             if (*d > dist) {
@@ -3838,7 +4126,7 @@ int FindFloorInBoxBU(br_vector3* a, br_vector3* b, br_vector3* nor, br_scalar* d
     if (*d >= 2.f) {
         return 0;
     }
-    i = gFace_list__car[j].material->identifier[0] - ('0' - 1);
+    i = c->box_faces[j].material->identifier[0] - ('0' - 1);
     if (i < 0 || i >= 11) {
         return 0;
     } else {
@@ -3861,7 +4149,7 @@ int FindFloorInBoxBU2(br_vector3* a, br_vector3* b, br_vector3* nor, br_scalar*
 #endif
     *d = 2.f;
     for (i = c->box_face_start; i < c->box_face_end; i++) {
-        face_ref = &gFace_list__car[i];
+        face_ref = &c->box_faces[i];
         if (!gEliminate_faces || SLOBYTE(face_ref->flags) >= 0) {
             CheckSingleFace(face_ref, a, b, &nor2, &dist);
             if (*d > dist) {
@@ -3884,7 +4172,7 @@ int FindFloorInBoxBU2(br_vector3* a, br_vector3* b, br_vector3* nor, br_scalar*
     if (*d >= 2.f) {
         return 0;
     }
-    i = gFace_list__car[j].material->identifier[0] - ('0' - 1);
+    i = c->box_faces[j].material->identifier[0] - ('0' - 1);
     if (i < 0 || i >= 11) {
         return 0;
     } else {
@@ -3929,7 +4217,7 @@ int BoxFaceIntersect(br_bounds* pB, br_matrix34* pM, br_matrix34* pMold, br_vect
     BrVector3InvScale((br_vector3*)pMold->m[3], (br_vector3*)pMold->m[3], WORLD_SCALE);
 
     for (i = c->box_face_start; i < c->box_face_end && i < c->box_face_start + 50; i++) {
-        f_ref = &gFace_list__car[i];
+        f_ref = &c->box_faces[i];
         if (SLOBYTE(f_ref->flags) >= 0 && f_ref->material->identifier[0] != '!') {
             BrVector3Sub(&tv, &f_ref->v[0], &pos);
             BrMatrix34TApplyV(&p[0], &tv, pM);
@@ -5775,6 +6063,7 @@ void InitialiseExternalCamera(void) {
 void FreezeCamera(void) {
     LOG_TRACE("()");
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     gCamera_frozen = 1;
 }
 
@@ -5947,6 +6236,9 @@ int CrashCarsTogetherSinglePass(br_scalar dt, int pPass, tCollison_data* collide
     LOG_TRACE("(%f, %d, %p)", dt, pPass, collide_list);
 
     collided = 0;
+    // Added by dethrace: every pair is still walked. A visited pair counts down both collide_list refs while either is
+    // positive, and that decides which later pairs are tried, so skipping pairs would change the results. With at most
+    // COUNT_OF(gActive_car_list) entries the pair test, a single bounds overlap, is not worth a broadphase either
     for (i = 0; i < gNum_cars_and_non_cars - 1; i++) {
         car_1 = (tCollision_info*)gActive_car_list[i];
         for (j = i + 1; j < gNum_cars_and_non_cars; j++) {
@@ -7320,6 +7612,7 @@ int PullActorFromWorld(br_actor* pActor) {
     LOG_TRACE("(%p)", pActor);
 
     if (gDoing_physics) {
+        CarPhysicsSideEffect(1); // Added by dethrace
         return DoPullActorFromWorld(pActor);
     }
     return 0;
@@ -7491,6 +7784,7 @@ void AdjustNonCar(br_actor* pActor, br_matrix34* pMat) {
 void PipeSingleNonCar(tCollision_info* c) {
     LOG_TRACE("(%p)", c);
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     StartPipingSession(ePipe_chunk_non_car);
     if (gDoing_physics) {
         BrVector3InvScale(&c->car_master_actor->t.t.translate.t, &c->car_master_actor->t.t.translate.t, WORLD_SCALE);
@@ -7506,9 +7800,8 @@ void PipeSingleNonCar(tCollision_info* c) {
 int GetPrecalculatedFacesUnderCar(tCar_spec* pCar, tFace_ref** pFace_refs) {
     LOG_TRACE("(%p, %p)", pCar, pFace_refs);
 
-    if (pCar->box_face_ref == gFace_num__car
-        || (pCar->box_face_ref == gFace_num__car - 1 && pCar->box_face_start > gFace_count)) {
-        *pFace_refs = &gFace_list__car[pCar->box_face_start];
+    if (pCar->box_face_ref == gFace_num__car) {
+        *pFace_refs = &pCar->box_faces[pCar->box_face_start];
         return pCar->box_face_end - pCar->box_face_start;
     }
     return 0;
@@ -2,6 +2,7 @@
 #define _CAR_H_
 
 #include "dr_types.h"
+#include "harness/compiler.h"
 
 #define CAR_MAX_SIMPLIFICATION_LEVEL 4
 
@@ -27,7 +28,7 @@ extern tU32 gOn_me_wheels_start;
 extern int gWoz_upside_down_at_all;
 extern tS3_sound_tag gSkid_tag[2];
 extern tCar_spec* gLast_car_to_skid[2];
-extern int gEliminate_faces;
+extern HARNESS_THREAD_LOCAL int gEliminate_faces;
 extern br_vector3 gZero_v__car; // suffix added to avoid duplicate symbol
 extern tU32 gSwitch_time;
 extern tSave_camera gSave_camera[2];
@@ -41,12 +42,10 @@ extern float gOffensive_powerup_factor[6];
 extern float gEngine_powerup_factor[6];
 extern br_angle gPanning_camera_angle;
 extern br_scalar gPanning_camera_height;
-extern int gFace_count;
 extern float gCar_simplification_factor[2][5];
 extern int gCar_simplification_level;
 extern int gNum_active_non_cars;
 extern int gCamera_has_collided;
-extern tFace_ref gFace_list__car[150]; // suffix added to avoid duplicate symbol
 extern tNon_car_spec* gActive_non_car_list[50];
 extern int gOver_shoot;
 extern br_scalar gMin_world_y;
@@ -55,7 +54,7 @@ extern br_vector3 gAverage_grid_position;
 extern br_actor* gPed_actor;
 extern int gCollision_count;
 extern int gCamera_frozen;
-extern int gMaterial_index;
+extern HARNESS_THREAD_LOCAL int gMaterial_index;
 extern int gInTheSea;
 extern int gCamera_mode;
 extern br_scalar gOur_yaw__car;            // suffix added to avoid duplicate symbol
@@ -113,6 +112,12 @@ void SetInitialPositions(tRace_info* pThe_race);
 
 void InitialiseNonCar(tNon_car_spec* non_car);
 
+void ResetFaceCache(tCollision_info* c);
+
+void DisposeFaceCaches(void);
+
+void CarPhysicsSideEffect(int pChanges_world);
+
 void GetFacesInBox(tCollision_info* c);
 
 int IsCarInTheSea(void);
@@ -14,6 +14,7 @@
 #include "globvrpb.h"
 #include "grafdata.h"
 #include "graphics.h"
+#include "harness/config.h"
 #include "harness/trace.h"
 #include "init.h"
 #include "input.h"
@@ -2013,11 +2014,45 @@ void PollCarControls(tU32 pTime_difference) {
                 keys.horn = 1;
             }
         }
+        // Added by dethrace: `--benchmark` has no keyboard, drive from a fixed script instead
+        if (harness_game_config.benchmark_seconds > 0 && !gRace_finished && !c->knackered && !gWait_for_it) {
+            BenchmarkCarControls(&keys);
+        }
         c->keys = keys;
         c->joystick = joystick;
     }
 }
 
+// Added by dethrace
+// Repeating input script used by `--benchmark`. A function of race time only, so every run is identical
+void BenchmarkCarControls(tCar_controls* pKeys) {
+    static struct {
+        tU32 end_time;
+        int acc;
+        int brake;
+        int left;
+        int right;
+    } script[] = {
+        { 6000, 1, 0, 0, 0 },
+        { 7000, 1, 0, 1, 0 },
+        { 10000, 1, 0, 0, 0 },
+        { 11500, 1, 0, 0, 1 },
+        { 13000, 0, 1, 0, 0 },
+        { 15000, 1, 0, 1, 0 },
+        { 20000, 1, 0, 0, 0 },
+    };
+    tU32 the_time;
+    int i;
+
+    the_time = GetRaceTime() % script[COUNT_OF(script) - 1].end_time;
+    for (i = 0; the_time >= script[i].end_time; i++) {
+    }
+    pKeys->acc = script[i].acc;
+    pKeys->brake = script[i].brake;
+    pKeys->left = script[i].left;
+    pKeys->right = script[i].right;
+}
+
 // IDA: void __usercall PollCameraControls(tU32 pTime_difference@<EAX>)
 void PollCameraControls(tU32 pTime_difference) {
     int flag;
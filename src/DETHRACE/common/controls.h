@@ -196,6 +196,8 @@ void BrakeInstantly(void);
 
 void PollCarControls(tU32 pTime_difference);
 
+void BenchmarkCarControls(tCar_controls* pKeys);
+
 void PollCameraControls(tU32 pTime_difference);
 
 void SetFlag2(int i);
@@ -340,6 +340,7 @@ void TotallySpamTheModel(tCar_spec* pCar, int pModel_index, br_actor* pActor, tC
     br_vertex* vertices;
     LOG_TRACE("(%p, %d, %p, %p, %f)", pCar, pModel_index, pActor, pCrush_data, pMagnitude);
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     if (gArrow_mode || pCrush_data->number_of_crush_points == 0) {
         return;
     }
@@ -519,6 +520,7 @@ void CheckLastCar(void) {
 void KnackerThisCar(tCar_spec* pCar) {
     LOG_TRACE("(%p)", pCar);
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     pCar->knackered = 1;
     QueueWastedMassage(pCar->index);
     CheckLastCar();
@@ -946,6 +948,7 @@ void SortOutSmoke(tCar_spec* pCar) {
 void StealCar(tCar_spec* pCar) {
     LOG_TRACE("(%p)", pCar);
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     pCar->has_been_stolen = 1;
     gProgram_state.cars_available[gProgram_state.number_of_cars] = pCar->index;
     gProgram_state.number_of_cars++;
@@ -1358,6 +1361,7 @@ void DoWheelDamage(tU32 pFrame_period) {
 void CrashEarnings(tCar_spec* pCar1, tCar_spec* pCar2) {
     LOG_TRACE("(%p, %p)", pCar1, pCar2);
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     if (DoCrashEarnings(pCar1, pCar2)) {
         SortOutSmoke(pCar1);
         SortOutSmoke(pCar2);
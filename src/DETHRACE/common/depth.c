@@ -7,6 +7,7 @@
 #include "globvrkm.h"
 #include "globvrpb.h"
 #include "harness/hooks.h"
+#include "harness/jobs.h"
 #include "harness/trace.h"
 #include "pd/sys.h"
 #include "replay.h"
@@ -17,6 +18,14 @@
 #include <math.h>
 #include <stdlib.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DEPTH_SHADE_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define DEPTH_SHADE_NEON
+#endif
+
 tDepth_effect gDistance_depth_effects[4];
 int gSky_on;
 int gDepth_cueing_on;
@@ -364,76 +373,174 @@ void InitDepthEffects(void) {
     gLast_camera_special_volume = 0;
 }
 
-// IDA: void __usercall DoDepthByShadeTable(br_pixelmap *pRender_buffer@<EAX>, br_pixelmap *pDepth_buffer@<EDX>, br_pixelmap *pShade_table@<EBX>, int pShade_table_power@<ECX>, int pStart, int pEnd)
-void DoDepthByShadeTable(br_pixelmap* pRender_buffer, br_pixelmap* pDepth_buffer, br_pixelmap* pShade_table, int pShade_table_power, int pStart, int pEnd) {
-    tU8* render_ptr;
+// Added by dethrace: rows handed to each job when DoDepthByShadeTable is split across the job pool
+#define DEPTH_BAND_ROWS 32
+
+// Added by dethrace: everything DoDepthByShadeTable works out before it starts on the pixels
+typedef struct tDepth_shade_pass {
+    tU8* render_pixels;
+    tU16* depth_pixels;
     tU8* shade_table_pixels;
-    tU16* depth_ptr;
-    tU16 depth_value;
-    tU16 too_near;
+    int render_row_bytes;
+    int depth_row_words;
+    int width;
+    int height;
+    int start;
     int depth_shift_amount;
-    int depth_start;
-    int y;
+    tU16 too_near;
+} tDepth_shade_pass;
+
+// Added by dethrace: the original per pixel test and lookup, for the pixels the vector loops leave over
+static void DepthShadePixels(tDepth_shade_pass* pPass, tU8* pRender_ptr, tU16* pDepth_ptr, int pCount) {
+    tU16 depth_value;
     int x;
-    int depth_line_skip;
-    int render_line_skip;
-    LOG_TRACE("(%p, %p, %p, %d, %d, %d)", pRender_buffer, pDepth_buffer, pShade_table, pShade_table_power, pStart, pEnd);
 
-    too_near = 0xffff - (1 << pStart);
-    shade_table_pixels = pShade_table->pixels;
-    depth_shift_amount = pShade_table_power + 8 - pStart - pEnd;
-    render_ptr = (tU8*)pRender_buffer->pixels + pRender_buffer->base_x + pRender_buffer->base_y * pRender_buffer->row_bytes;
-    depth_ptr = pDepth_buffer->pixels;
-    render_line_skip = pRender_buffer->row_bytes - pRender_buffer->width;
-    depth_line_skip = pDepth_buffer->row_bytes / 2 - pRender_buffer->width;
-
-    if (depth_shift_amount <= 0) {
-        if (depth_shift_amount >= 0) {
-            for (y = 0; y < pRender_buffer->height; ++y) {
-                for (x = 0; x < pRender_buffer->width; ++x) {
-                    if (*depth_ptr != 0xFFFF) {
-                        depth_value = *depth_ptr - too_near;
-                        if (depth_value < -(int16_t)too_near) {
-                            *render_ptr = shade_table_pixels[(depth_value & 0xFF00) + *render_ptr];
-                        }
-                    }
-                    ++render_ptr;
-                    ++depth_ptr;
+    for (x = 0; x < pCount; x++) {
+        if (pDepth_ptr[x] != 0xFFFF) {
+            depth_value = pDepth_ptr[x] - pPass->too_near;
+            if (depth_value < -(int16_t)pPass->too_near) {
+                if (pPass->depth_shift_amount >= 0) {
+                    pRender_ptr[x] = pPass->shade_table_pixels[pRender_ptr[x] + ((depth_value << pPass->depth_shift_amount) & 0xFF00)];
+                } else {
+                    pRender_ptr[x] = pPass->shade_table_pixels[pRender_ptr[x] + ((depth_value >> -pPass->depth_shift_amount) & 0xFF00)];
                 }
-                render_ptr += render_line_skip;
-                depth_ptr += depth_line_skip;
             }
-        } else {
-            for (y = 0; pRender_buffer->height > y; ++y) {
-                for (x = 0; pRender_buffer->width > x; ++x) {
-                    if (*depth_ptr != 0xFFFF) {
-                        depth_value = *depth_ptr - too_near;
-                        if (depth_value < -(int16_t)too_near) {
-                            *render_ptr = shade_table_pixels[*render_ptr + ((depth_value >> (pEnd - (pShade_table_power + 8 - pStart))) & 0xFF00)];
-                        }
-                    }
-                    ++render_ptr;
-                    ++depth_ptr;
+        }
+    }
+}
+
+// Added by dethrace
+// Shade rows [pFirst_row, pLast_row). Most of the screen is nearer than the start of the effect, so 16 depths at a time
+// are tested with vector compares and a block with nothing to shade is skipped. The shade table lookups are gathers,
+// which stay scalar. A depth is shaded when it is not clear and less than 2^start below too_near wrapping round,
+// exactly as the original test for the starts below 15 that reach here
+static void DepthShadeRows(tDepth_shade_pass* pPass, int pFirst_row, int pLast_row) {
+    tU8* render_ptr;
+    tU16* depth_ptr;
+    int x;
+    int y;
+#if defined(DEPTH_SHADE_SSE2)
+    tU16 rows[16];
+    unsigned int mask;
+    int i;
+    __m128i too_near = _mm_set1_epi16((short)pPass->too_near);
+    __m128i clear = _mm_set1_epi16((short)0xFFFF);
+    __m128i zero = _mm_setzero_si128();
+    __m128i row_mask = _mm_set1_epi16((short)0xFF00);
+    __m128i start = _mm_cvtsi32_si128(pPass->start);
+    __m128i shift = _mm_cvtsi32_si128(pPass->depth_shift_amount >= 0 ? pPass->depth_shift_amount : -pPass->depth_shift_amount);
+    __m128i depth_lo;
+    __m128i depth_hi;
+    __m128i value_lo;
+    __m128i value_hi;
+    __m128i shade_lo;
+    __m128i shade_hi;
+#elif defined(DEPTH_SHADE_NEON)
+    tU16 rows[16];
+    int i;
+    uint16x8_t too_near = vdupq_n_u16(pPass->too_near);
+    uint16x8_t clear = vdupq_n_u16(0xFFFF);
+    uint16x8_t row_mask = vdupq_n_u16(0xFF00);
+    int16x8_t start = vdupq_n_s16(-pPass->start);
+    int16x8_t shift = vdupq_n_s16(pPass->depth_shift_amount);
+    uint16x8_t depth_lo;
+    uint16x8_t depth_hi;
+    uint16x8_t value_lo;
+    uint16x8_t value_hi;
+    uint16x8_t shade_lo;
+    uint16x8_t shade_hi;
+#endif
+
+    for (y = pFirst_row; y < pLast_row; y++) {
+        render_ptr = pPass->render_pixels + y * pPass->render_row_bytes;
+        depth_ptr = pPass->depth_pixels + y * pPass->depth_row_words;
+        x = 0;
+#if defined(DEPTH_SHADE_SSE2)
+        for (; x + 16 <= pPass->width; x += 16) {
+            depth_lo = _mm_loadu_si128((__m128i*)&depth_ptr[x]);
+            depth_hi = _mm_loadu_si128((__m128i*)&depth_ptr[x + 8]);
+            value_lo = _mm_sub_epi16(depth_lo, too_near);
+            value_hi = _mm_sub_epi16(depth_hi, too_near);
+            shade_lo = _mm_andnot_si128(_mm_cmpeq_epi16(depth_lo, clear), _mm_cmpeq_epi16(_mm_srl_epi16(value_lo, start), zero));
+            shade_hi = _mm_andnot_si128(_mm_cmpeq_epi16(depth_hi, clear), _mm_cmpeq_epi16(_mm_srl_epi16(value_hi, start), zero));
+            mask = _mm_movemask_epi8(_mm_packs_epi16(shade_lo, shade_hi));
+            if (mask == 0) {
+                continue;
+            }
+            if (pPass->depth_shift_amount >= 0) {
+                value_lo = _mm_sll_epi16(value_lo, shift);
+                value_hi = _mm_sll_epi16(value_hi, shift);
+            } else {
+                value_lo = _mm_srl_epi16(value_lo, shift);
+                value_hi = _mm_srl_epi16(value_hi, shift);
+            }
+            _mm_storeu_si128((__m128i*)&rows[0], _mm_and_si128(value_lo, row_mask));
+            _mm_storeu_si128((__m128i*)&rows[8], _mm_and_si128(value_hi, row_mask));
+            for (i = 0; i < 16; i++) {
+                if (mask & (1 << i)) {
+                    render_ptr[x + i] = pPass->shade_table_pixels[render_ptr[x + i] + rows[i]];
                 }
-                render_ptr += render_line_skip;
-                depth_ptr += depth_line_skip;
             }
         }
-    } else {
-        for (y = 0; pRender_buffer->height > y; ++y) {
-            for (x = 0; pRender_buffer->width > x; ++x) {
-                if (*depth_ptr != 0xFFFF) {
-                    depth_value = *depth_ptr - too_near;
-                    if (depth_value < -(int16_t)too_near) {
-                        *render_ptr = shade_table_pixels[*render_ptr + ((depth_value << depth_shift_amount) & 0xFF00)];
-                    }
+#elif defined(DEPTH_SHADE_NEON)
+        for (; x + 16 <= pPass->width; x += 16) {
+            depth_lo = vld1q_u16(&depth_ptr[x]);
+            depth_hi = vld1q_u16(&depth_ptr[x + 8]);
+            value_lo = vsubq_u16(depth_lo, too_near);
+            value_hi = vsubq_u16(depth_hi, too_near);
+            shade_lo = vbicq_u16(vceqq_u16(vshlq_u16(value_lo, start), vdupq_n_u16(0)), vceqq_u16(depth_lo, clear));
+            shade_hi = vbicq_u16(vceqq_u16(vshlq_u16(value_hi, start), vdupq_n_u16(0)), vceqq_u16(depth_hi, clear));
+            if (vmaxvq_u16(vorrq_u16(shade_lo, shade_hi)) == 0) {
+                continue;
+            }
+            // vshlq shifts right for a negative amount. Pixels left alone get 0xFFFF, which no shade row can be
+            vst1q_u16(&rows[0], vbslq_u16(shade_lo, vandq_u16(vshlq_u16(value_lo, shift), row_mask), clear));
+            vst1q_u16(&rows[8], vbslq_u16(shade_hi, vandq_u16(vshlq_u16(value_hi, shift), row_mask), clear));
+            for (i = 0; i < 16; i++) {
+                if (rows[i] != 0xFFFF) {
+                    render_ptr[x + i] = pPass->shade_table_pixels[render_ptr[x + i] + rows[i]];
                 }
-                ++render_ptr;
-                ++depth_ptr;
             }
-            render_ptr += render_line_skip;
-            depth_ptr += depth_line_skip;
         }
+#endif
+        DepthShadePixels(pPass, render_ptr + x, depth_ptr + x, pPass->width - x);
+    }
+}
+
+// Added by dethrace
+static void DepthShadeBandJob(void* pContext, int pIndex) {
+    tDepth_shade_pass* pass;
+
+    pass = pContext;
+    DepthShadeRows(pass, pIndex * DEPTH_BAND_ROWS, MIN((pIndex + 1) * DEPTH_BAND_ROWS, pass->height));
+}
+
+// IDA: void __usercall DoDepthByShadeTable(br_pixelmap *pRender_buffer@<EAX>, br_pixelmap *pDepth_buffer@<EDX>, br_pixelmap *pShade_table@<EBX>, int pShade_table_power@<ECX>, int pStart, int pEnd)
+void DoDepthByShadeTable(br_pixelmap* pRender_buffer, br_pixelmap* pDepth_buffer, br_pixelmap* pShade_table, int pShade_table_power, int pStart, int pEnd) {
+    tDepth_shade_pass pass;
+    LOG_TRACE("(%p, %p, %p, %d, %d, %d)", pRender_buffer, pDepth_buffer, pShade_table, pShade_table_power, pStart, pEnd);
+
+    // Added by dethrace: from a start of 15 too_near no longer fits below 0x8000 and the original test never passes,
+    // while the vector one would. So leave every pixel alone, as the original does
+    if (pStart >= 15) {
+        return;
+    }
+    pass.too_near = 0xffff - (1 << pStart);
+    pass.shade_table_pixels = pShade_table->pixels;
+    pass.depth_shift_amount = pShade_table_power + 8 - pStart - pEnd;
+    pass.render_pixels = (tU8*)pRender_buffer->pixels + pRender_buffer->base_x + pRender_buffer->base_y * pRender_buffer->row_bytes;
+    pass.depth_pixels = pDepth_buffer->pixels;
+    pass.render_row_bytes = pRender_buffer->row_bytes;
+    pass.depth_row_words = pDepth_buffer->row_bytes / 2;
+    pass.width = pRender_buffer->width;
+    pass.height = pRender_buffer->height;
+    pass.start = pStart;
+
+    // Added by dethrace: bands of rows are independent, so they can be shared out
+    if (Harness_Jobs_ThreadCount() > 1 && pass.height > DEPTH_BAND_ROWS) {
+        Harness_Jobs_ParallelFor(DepthShadeBandJob, &pass, (pass.height + DEPTH_BAND_ROWS - 1) / DEPTH_BAND_ROWS);
+    } else {
+        DepthShadeRows(&pass, 0, pass.height);
     }
 }
 
@@ -6,7 +6,7 @@
 
 br_allocator gAllocator = { "Death Race", DRStdlibAllocate, DRStdlibFree, DRStdlibInquire, Claim4ByteAlignment };
 int gNon_fatal_allocation_errors = 0;
-char* gMem_names[247] = {
+char* gMem_names[255] = {
     "",
     "BR_MEMORY_SCRATCH",
     "BR_MEMORY_PIXELMAP",
@@ -253,6 +253,14 @@ char* gMem_names[247] = {
     "kMem_abuse_text",
     "kMem_action_replay_buffer",
     "kMem_misc",
+    "kMem_face_grid",
+    "kMem_face_cache",
+    "kMem_car_jobs",
+    "kMem_oppo_path_index",
+    "kMem_visible_columns",
+    "kMem_column_visibility",
+    "kMem_palette_match",
+    "kMem_pipe_frame_index",
     NULL,
 };
 br_resource_class gStainless_classes[118];
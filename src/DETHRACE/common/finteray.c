@@ -4,24 +4,28 @@
 #include "car.h"
 #include "formats.h"
 #include "globvars.h"
+#include "harness/compiler.h"
 #include "harness/trace.h"
 #include "raycast.h"
 #include "world.h"
 #include <math.h>
 #include <stdlib.h>
 
-int gPling_materials = 1;
+// Added by dethrace: the ray and box pick state is thread local, cars may be moved on several threads at once
+HARNESS_THREAD_LOCAL int gPling_materials = 1;
 br_material* gSub_material;
 br_material* gReal_material;
 int gNfaces;
-br_matrix34 gPick_model_to_view__finteray; // suffix added to avoid duplicate symbol
-int gTemp_group;
-br_model* gNearest_model;
+HARNESS_THREAD_LOCAL br_matrix34 gPick_model_to_view__finteray; // suffix added to avoid duplicate symbol
+HARNESS_THREAD_LOCAL int gTemp_group;
+HARNESS_THREAD_LOCAL br_model* gNearest_model;
 br_model* gSelected_model;
-int gNearest_face_group;
-int gNearest_face;
-br_scalar gNearest_T;
-tFace_ref* gPling_face;
+HARNESS_THREAD_LOCAL int gNearest_face_group;
+HARNESS_THREAD_LOCAL int gNearest_face;
+HARNESS_THREAD_LOCAL br_scalar gNearest_T;
+HARNESS_THREAD_LOCAL tFace_ref* gPling_face;
+// Added by dethrace: blend actor that ActorBoxPick treats as visible, see FaceGridPickBox
+HARNESS_THREAD_LOCAL br_actor* gPick_blend;
 
 // IDA: int __cdecl BadDiv(br_scalar a, br_scalar b)
 // Suffix added to avoid duplicate symbol
@@ -694,6 +698,12 @@ int FindFacesInBox(tBounds* bnds, tFace_ref* face_list, int max_face) {
     if (cz_max + 1 < track_spec->ncolumns_z) {
         cz_max++;
     }
+    // Added by dethrace: scan the flattened faces instead of walking the column actors
+    if (track_spec->face_grid.cells != NULL) {
+        return FaceGridPickBox(bnds, track_spec, cx_min, cx_max, cz_min, cz_max, face_list, max_face);
+    }
+    // Added by dethrace: showing the blend actors would race with other threads picking the same column
+    CarPhysicsSideEffect(0);
     for (x = cx_min; x <= cx_max; x++) {
         for (z = cz_min; z <= cz_max; z++) {
             if (track_spec->columns[z][x] != NULL) {
@@ -713,6 +723,108 @@ int FindFacesInBox(tBounds* bnds, tFace_ref* face_list, int max_face) {
     return j;
 }
 
+// Added by dethrace: ModelPickBox over the face grid built by BuildFaceGrid.
+// Returns the number of faces found, exactly as the column loop in FindFacesInBox would
+int FaceGridPickBox(tBounds* bnds, tTrack_spec* pTrack_spec, int pMin_x, int pMax_x, int pMin_z, int pMax_z, tFace_ref* face_list, int max_face) {
+    int i;
+    int j;
+    int k;
+    int n;
+    int x;
+    int z;
+    tFace_grid* grid;
+    tFace_grid_cell* cell;
+    tFace_grid_face* face;
+    tFace_grid_face_info* info;
+    br_vector3 polygon[12];
+    br_vector3 a;
+    br_scalar t;
+
+    j = 0;
+    grid = &pTrack_spec->face_grid;
+    for (x = pMin_x; x <= pMax_x; x++) {
+        for (z = pMin_z; z <= pMax_z; z++) {
+            cell = &grid->cells[z * pTrack_spec->ncolumns_x + x];
+            if (cell->count == 0) {
+                continue;
+            }
+            // actor entries are walked even when the list is full, ActorBoxPick knocks non-cars loose
+            if (!cell->has_actors && (j == max_face || !BoundsOverlapTest__finteray(&cell->bounds, &bnds->real_bounds))) {
+                continue;
+            }
+            // the blend actor is shown to ActorBoxPick without touching its render style, other threads may be picking too
+            gPick_blend = cell->has_actors ? pTrack_spec->blends[z][x] : NULL;
+            for (i = cell->first; i < cell->first + cell->count; i++) {
+                info = &grid->info[i];
+                if (info->group == NULL) {
+                    j = max_face - ActorBoxPick(bnds, info->actor, info->model, info->material, &face_list[j], max_face - j, NULL);
+                    continue;
+                }
+                if (j == max_face) {
+                    continue;
+                }
+                face = &grid->faces[i];
+                if (face->bounds.max.v[0] < bnds->real_bounds.min.v[0]
+                    || face->bounds.min.v[0] > bnds->real_bounds.max.v[0]
+                    || face->bounds.max.v[1] < bnds->real_bounds.min.v[1]
+                    || face->bounds.min.v[1] > bnds->real_bounds.max.v[1]
+                    || face->bounds.max.v[2] < bnds->real_bounds.min.v[2]
+                    || face->bounds.min.v[2] > bnds->real_bounds.max.v[2]) {
+                    continue;
+                }
+                BrVector3Sub(&a, &face->v[0], &bnds->box_centre);
+                t = BrVector3Dot((br_vector3*)&face->eqn, &a);
+                if (fabsf(t) > bnds->radius) {
+                    continue;
+                }
+                BrVector3Sub(&polygon[1], &face->v[0], (br_vector3*)bnds->mat->m[3]);
+                BrVector3Sub(&polygon[2], &face->v[1], (br_vector3*)bnds->mat->m[3]);
+                BrVector3Sub(&polygon[3], &face->v[2], (br_vector3*)bnds->mat->m[3]);
+                BrMatrix34TApplyV(&polygon[0], &polygon[1], bnds->mat);
+                BrMatrix34TApplyV(&polygon[1], &polygon[2], bnds->mat);
+                BrMatrix34TApplyV(&polygon[2], &polygon[3], bnds->mat);
+                n = 3;
+                for (k = 0; k < 3; k++) {
+                    ClipToPlaneGE(&polygon[0], &n, k, bnds->original_bounds.min.v[k]);
+                    if (n < 3) {
+                        break;
+                    }
+                    ClipToPlaneLE(&polygon[0], &n, k, bnds->original_bounds.max.v[k]);
+                    if (n < 3) {
+                        break;
+                    }
+                }
+                if (n < 3) {
+                    continue;
+                }
+                for (k = 0; k < 3; k++) {
+                    BrVector3Copy(&face_list[j].v[k], &face->v[k]);
+                    face_list[j].map[k] = &info->group->map[info->vertex_numbers[k]];
+                }
+                BrVector3Copy(&face_list[j].normal, (br_vector3*)&face->eqn);
+                if (info->group->user != NULL) {
+                    face_list[j].material = info->group->user;
+                } else {
+                    face_list[j].material = info->material;
+                }
+                face_list[j].flags = 0;
+                if (face_list[j].material != NULL && (face_list[j].material->flags & (BR_MATF_TWO_SIDED | BR_MATF_ALWAYS_VISIBLE)) == 0) {
+                    face_list[j].flags = info->flags;
+                }
+                face_list[j].d = face->eqn.v[3];
+                if (face_list[j].material != NULL
+                    && face_list[j].material->identifier != NULL
+                    && face_list[j].material->identifier[0] == '!') {
+                    gPling_face = &face_list[j];
+                }
+                j++;
+            }
+            gPick_blend = NULL;
+        }
+    }
+    return j;
+}
+
 // IDA: int __usercall FindFacesInBox2@<EAX>(tBounds *bnds@<EAX>, tFace_ref *face_list@<EDX>, int max_face@<EBX>)
 int FindFacesInBox2(tBounds* bnds, tFace_ref* face_list, int max_face) {
     br_vector3 a;
@@ -769,7 +881,7 @@ int ActorBoxPick(tBounds* bnds, br_actor* ap, br_model* model, br_material* mate
     } else {
         this_material = material;
     }
-    if (ap->render_style == BR_RSTYLE_NONE) {
+    if (ap->render_style == BR_RSTYLE_NONE && ap != gPick_blend) {
         return max_face;
     }
     if (ap->identifier != NULL && ap->identifier[0] == '&') {
@@ -1332,6 +1444,8 @@ void Scale(int pD, int factor) {
         }
     }
     BrModelUpdate(gSelected_model, BR_MODU_ALL);
+    // Added by dethrace: the face grid points into the old prepared model
+    RefreshFaceGrid(&gProgram_state.track_spec);
 }
 
 // IDA: void __cdecl ScaleUpX()
@@ -2,19 +2,21 @@
 #define _FINTERAY_H_
 
 #include "dr_types.h"
+#include "harness/compiler.h"
 
-extern int gPling_materials;
+extern HARNESS_THREAD_LOCAL int gPling_materials;
 extern br_material* gSub_material;
 extern br_material* gReal_material;
 extern int gNfaces;
-extern br_matrix34 gPick_model_to_view__finteray; // suffix added to avoid duplicate symbol
-extern int gTemp_group;
-extern br_model* gNearest_model;
+extern HARNESS_THREAD_LOCAL br_matrix34 gPick_model_to_view__finteray; // suffix added to avoid duplicate symbol
+extern HARNESS_THREAD_LOCAL int gTemp_group;
+extern HARNESS_THREAD_LOCAL br_model* gNearest_model;
 extern br_model* gSelected_model;
-extern int gNearest_face_group;
-extern int gNearest_face;
-extern br_scalar gNearest_T;
-extern tFace_ref* gPling_face;
+extern HARNESS_THREAD_LOCAL int gNearest_face_group;
+extern HARNESS_THREAD_LOCAL int gNearest_face;
+extern HARNESS_THREAD_LOCAL br_scalar gNearest_T;
+extern HARNESS_THREAD_LOCAL tFace_ref* gPling_face;
+extern HARNESS_THREAD_LOCAL br_actor* gPick_blend; // Added by dethrace
 
 // Suffix added to avoid duplicate symbol
 int BadDiv__finteray(br_scalar a, br_scalar b);
@@ -52,6 +54,8 @@ void GetNewBoundingBox(br_bounds* b2, br_bounds* b1, br_matrix34* m);
 
 int FindFacesInBox(tBounds* bnds, tFace_ref* face_list, int max_face);
 
+int FaceGridPickBox(tBounds* bnds, tTrack_spec* pTrack_spec, int pMin_x, int pMax_x, int pMin_z, int pMax_z, tFace_ref* face_list, int max_face);
+
 int FindFacesInBox2(tBounds* bnds, tFace_ref* face_list, int max_face);
 
 int ActorBoxPick(tBounds* bnds, br_actor* ap, br_model* model, br_material* material, tFace_ref* face_list, int max_face, br_matrix34* pMat);
@@ -35,9 +35,15 @@
 #include "world.h"
 #include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <math.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLEAR_STAGE_SSE2
+#endif
+
 int gPalette_munged;
 int gColourValues[1];
 int gNext_transient;
@@ -1507,30 +1513,101 @@ void FlashyMapCheckpoint(int pIndex, tU32 pTime) {
     }
 }
 
-// IDA: int __usercall ConditionallyFillWithSky@<EAX>(br_pixelmap *pPixelmap@<EAX>)
-int ConditionallyFillWithSky(br_pixelmap* pPixelmap) {
-    int bgnd_col;
-    LOG_TRACE("(%p)", pPixelmap);
-
+// Added by dethrace: the colour ConditionallyFillWithSky would fill with, or -1 if a sky texture is drawn instead
+static int SkyFillColour(void) {
     if (gProgram_state.current_depth_effect.sky_texture != NULL && (gLast_camera_special_volume == NULL || gLast_camera_special_volume->sky_col < 0)) {
-        return 0;
+        return -1;
     }
 
     if (gProgram_state.current_depth_effect.type == eDepth_effect_fog || gSwap_depth_effect_type == eDepth_effect_fog) {
-        bgnd_col = 255;
+        return 255;
     } else if (gProgram_state.current_depth_effect.type && gSwap_depth_effect_type) {
         if (gLast_camera_special_volume && gLast_camera_special_volume->sky_col >= 0) {
-            bgnd_col = gLast_camera_special_volume->sky_col;
+            return gLast_camera_special_volume->sky_col;
         } else {
-            bgnd_col = 0;
+            return 0;
         }
     } else {
-        bgnd_col = 0;
+        return 0;
+    }
+}
+
+// IDA: int __usercall ConditionallyFillWithSky@<EAX>(br_pixelmap *pPixelmap@<EAX>)
+int ConditionallyFillWithSky(br_pixelmap* pPixelmap) {
+    int bgnd_col;
+    LOG_TRACE("(%p)", pPixelmap);
+
+    bgnd_col = SkyFillColour();
+    if (bgnd_col < 0) {
+        return 0;
     }
     BrPixelmapFill(pPixelmap, bgnd_col);
     return 1;
 }
 
+// Added by dethrace: fill one row with a repeated 16 byte pattern, bypassing the cache where we can
+static void StreamFillRow(tU8* pDst, int pBytes, tU8 pValue) {
+#if defined(CLEAR_STAGE_SSE2)
+    __m128i pattern;
+    int head;
+
+    head = (int)(-(uintptr_t)pDst & 15);
+    if (head > pBytes) {
+        head = pBytes;
+    }
+    memset(pDst, pValue, head);
+    pDst += head;
+    pBytes -= head;
+    pattern = _mm_set1_epi8((char)pValue);
+    for (; pBytes >= 64; pBytes -= 64, pDst += 64) {
+        _mm_stream_si128((__m128i*)pDst, pattern);
+        _mm_stream_si128((__m128i*)(pDst + 16), pattern);
+        _mm_stream_si128((__m128i*)(pDst + 32), pattern);
+        _mm_stream_si128((__m128i*)(pDst + 48), pattern);
+    }
+    for (; pBytes >= 16; pBytes -= 16, pDst += 16) {
+        _mm_stream_si128((__m128i*)pDst, pattern);
+    }
+#endif
+    memset(pDst, pValue, pBytes);
+}
+
+// Added by dethrace: clears the depth buffer under pPixelmap and, when ConditionallyFillWithSky would fill
+// it with a solid colour, does that in the same walk down the rows rather than as two full-screen passes.
+// Returns what ConditionallyFillWithSky would have returned.
+int ClearDepthAndConditionallyFillWithSky(br_pixelmap* pPixelmap, br_pixelmap* pDepth_buffer) {
+    int bgnd_col;
+    int y;
+    tU8* colour_row;
+    tU8* depth_row;
+    LOG_TRACE("(%p, %p)", pPixelmap, pDepth_buffer);
+
+    if (pPixelmap->type != BR_PMT_INDEX_8
+        || pDepth_buffer->type != BR_PMT_DEPTH_16
+        || pDepth_buffer->width < pPixelmap->width
+        || pDepth_buffer->height < pPixelmap->height) {
+        BrPixelmapRectangleFill(pDepth_buffer, 0, 0, pPixelmap->width, pPixelmap->height, 0xFFFFFFFF);
+        return ConditionallyFillWithSky(pPixelmap);
+    }
+
+    bgnd_col = SkyFillColour();
+    colour_row = (tU8*)pPixelmap->pixels + pPixelmap->base_x + pPixelmap->base_y * pPixelmap->row_bytes;
+    depth_row = (tU8*)pDepth_buffer->pixels + pDepth_buffer->base_x * 2 + pDepth_buffer->base_y * pDepth_buffer->row_bytes;
+    for (y = 0; y < pPixelmap->height; y++) {
+        StreamFillRow(depth_row, pPixelmap->width * 2, 0xFF);
+        if (bgnd_col >= 0) {
+            StreamFillRow(colour_row, pPixelmap->width, (tU8)bgnd_col);
+        }
+        colour_row += pPixelmap->row_bytes;
+        depth_row += pDepth_buffer->row_bytes;
+    }
+#if defined(CLEAR_STAGE_SSE2)
+    // streamed stores are weakly ordered; make them visible before the renderer reads the buffers back
+    _mm_sfence();
+#endif
+    return bgnd_col >= 0;
+}
+
 // IDA: void __usercall RenderAFrame(int pDepth_mask_on@<EAX>)
 void RenderAFrame(int pDepth_mask_on) {
     int cat;
@@ -1629,7 +1706,6 @@ void RenderAFrame(int pDepth_mask_on) {
     }
     gRender_screen->pixels = (char*)gRender_screen->pixels + x_shift + y_shift * gRender_screen->row_bytes;
     CalculateConcussion(the_time);
-    BrPixelmapRectangleFill(gDepth_buffer, 0, 0, gRender_screen->width, gRender_screen->height, 0xFFFFFFFF);
     if (gRender_indent && !gMap_mode) {
         BrPixelmapRectangleFill(
             gBack_screen,
@@ -1662,7 +1738,8 @@ void RenderAFrame(int pDepth_mask_on) {
     }
     gRendering_mirror = 0;
     DoSpecialCameraEffect(gCamera, &gCamera_to_world);
-    if (!ConditionallyFillWithSky(gRender_screen)
+    // Added by dethrace: depth clear moved down here so it can share a pass with the sky fill
+    if (!ClearDepthAndConditionallyFillWithSky(gRender_screen, gDepth_buffer)
         && !gProgram_state.cockpit_on
         && !(gAction_replay_camera_mode && gAction_replay_mode)) {
         ExternalSky(gRender_screen, gDepth_buffer, gCamera, &gCamera_to_world);
@@ -1691,10 +1768,12 @@ void RenderAFrame(int pDepth_mask_on) {
     }
     BrMatrix34Copy(&gCamera->t.t.mat, &old_camera_matrix);
     if (gMirror_on__graphics) {
-        BrPixelmapFill(gRearview_depth_buffer, 0xFFFFFFFF);
         gRendering_mirror = 1;
         DoSpecialCameraEffect(gRearview_camera, &gRearview_camera_to_world);
-        ConditionallyFillWithSky(gRearview_screen);
+        ClearDepthAndConditionallyFillWithSky(gRearview_screen, gRearview_depth_buffer);
+        // Added by dethrace: the mirror cannot be drawn alongside the main view. BRender's Z-buffer renderer keeps a single
+        // scene state between BrZbSceneRenderBegin and BrZbSceneRenderEnd, and DrawColumns toggles render_style on column
+        // actors both views share. Its column culling is too small a part of the frame to be worth taking off the main thread
         BrZbSceneRenderBegin(gUniverse_actor, gRearview_camera, gRearview_screen, gRearview_depth_buffer);
         ProcessNonTrackActors(
             gRearview_screen,
@@ -184,6 +184,8 @@ void FlashyMapCheckpoint(int pIndex, tU32 pTime);
 
 int ConditionallyFillWithSky(br_pixelmap* pPixelmap);
 
+int ClearDepthAndConditionallyFillWithSky(br_pixelmap* pPixelmap, br_pixelmap* pDepth_buffer);
+
 void RenderAFrame(int pDepth_mask_on);
 
 void InitPaletteAnimate(void);
@@ -119,7 +119,22 @@ void GameMain(int pArgc, char** pArgv) {
         fprintf(stderr, "Can't find the Carmageddon CD\n");
         exit(1);
     }
+    // Added by dethrace: headless benchmark runs need no sound or cutscenes
+    if (harness_game_config.benchmark_seconds > 0) {
+        gSound_override = 1;
+        gCut_scene_override = 1;
+    }
+    // nor does playing a recorded replay
+    if (harness_game_config.play_replay_path[0] != '\0') {
+        gCut_scene_override = 1;
+    }
     InitialiseDeathRace(pArgc, pArgv);
-    DoProgram();
+    if (harness_game_config.benchmark_seconds > 0) {
+        DoBenchmarkRace();
+    } else if (harness_game_config.play_replay_path[0] != '\0') {
+        DoRecordedReplay();
+    } else {
+        DoProgram();
+    }
     QuitGame();
 }
@@ -11,8 +11,10 @@
 #include "globvrkm.h"
 #include "globvrpb.h"
 #include "graphics.h"
+#include "harness/benchmark.h"
 #include "harness/config.h"
 #include "harness/hooks.h"
+#include "harness/profile.h"
 #include "harness/trace.h"
 #include "input.h"
 #include "main.h"
@@ -525,7 +527,9 @@ tRace_result MainGameLoop(void) {
         frame_start_time = GetTotalTime();
         CyclePollKeys();
         CheckSystemKeys(1);
+        PROFILE_ZONE_BEGIN(eProfile_zone_net_receive);
         NetReceiveAndProcessMessages();
+        PROFILE_ZONE_END(eProfile_zone_net_receive);
         if (gHost_abandon_game || gProgram_state.prog_status == eProg_idling) {
             break;
         }
@@ -544,7 +548,9 @@ tRace_result MainGameLoop(void) {
         }
         ResetLollipopQueue();
         if (!gAction_replay_mode) {
+            PROFILE_ZONE_BEGIN(eProfile_zone_opponents);
             MungeOpponents(gFrame_period);
+            PROFILE_ZONE_END(eProfile_zone_opponents);
             PollCarControls(gFrame_period);
         }
         PollCameraControls(camera_period);
@@ -552,8 +558,12 @@ tRace_result MainGameLoop(void) {
             DoActionReplay(gFrame_period);
         } else {
             ControlOurCar(gFrame_period);
+            PROFILE_ZONE_BEGIN(eProfile_zone_physics);
             ApplyPhysicsToCars(gLast_tick_count - gRace_start, gFrame_period);
+            PROFILE_ZONE_END(eProfile_zone_physics);
+            PROFILE_ZONE_BEGIN(eProfile_zone_pipe_cars);
             PipeCarPositions();
+            PROFILE_ZONE_END(eProfile_zone_pipe_cars);
             NetSendMessageStacks();
             CheckRecoveryOfCars(gFrame_period + gLast_tick_count - gRace_start);
         }
@@ -573,12 +583,16 @@ tRace_result MainGameLoop(void) {
             CheckCheckpoints();
         }
         ChangingView();
+        PROFILE_ZONE_BEGIN(eProfile_zone_car_graphics);
         MungeCarGraphics(gFrame_period);
+        PROFILE_ZONE_END(eProfile_zone_car_graphics);
         FunkThoseTronics();
         GrooveThoseDelics();
         DoWheelDamage(gFrame_period);
         CalculateFrameRate();
+        PROFILE_ZONE_BEGIN(eProfile_zone_pedestrians);
         MungePedestrians(gFrame_period);
+        PROFILE_ZONE_END(eProfile_zone_pedestrians);
         CameraBugFix(&gProgram_state.current_car, camera_period);
         if (!gAction_replay_mode) {
             MungeHeadups();
@@ -590,7 +604,9 @@ tRace_result MainGameLoop(void) {
         EnterUserMessage();
         SkidsPerFrame();
         if (!gWait_for_it) {
+            PROFILE_ZONE_BEGIN(eProfile_zone_render);
             RenderAFrame(1);
+            PROFILE_ZONE_END(eProfile_zone_render);
         }
         CheckReplayTurnOn();
         if (!gRecover_car
@@ -633,11 +649,19 @@ tRace_result MainGameLoop(void) {
             PrintMemoryDump(0, "JUST RENDERED 1ST STUFF");
             InitialisePiping();
             PrintMemoryDump(0, "JUST ALLOCATED ACTION REPLAY BUFFER");
+            // Added by dethrace
+            if (harness_game_config.play_replay_path[0] != '\0') {
+                PlayRecordedReplay();
+            }
         }
         if (gNet_mode == eNet_mode_client && gAbandon_game) {
             gProgram_state.prog_status = eProg_idling;
             gAbandon_game = 0;
         }
+        // Added by dethrace: `--benchmark` ends the race once its virtual duration has elapsed
+        if (Harness_Benchmark_EndFrame()) {
+            gAbandon_game = 1;
+        }
 
     } while (gProgram_state.prog_status == eProg_game_ongoing
         && !MungeRaceFinished()
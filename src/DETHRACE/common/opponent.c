@@ -10,6 +10,8 @@
 #include "globvrkm.h"
 #include "globvrme.h"
 #include "globvrpb.h"
+#include "harness/config.h"
+#include "harness/os.h"
 #include "harness/trace.h"
 #include "loading.h"
 #include "oppoproc.h"
@@ -19,8 +21,53 @@
 #include "utility.h"
 
 #include <float.h>
+#include <limits.h>
 #include <stdlib.h>
 
+// Added by dethrace: path nodes and sections this close to a box in a path index are always searched, which covers
+// the rounding in the distances the searches compare
+#define PATH_INDEX_SLACK 0.01f
+#define PATH_INDEX_LEAF_SIZE 4
+// Added by dethrace: number of routes remembered by FindRouteToSection, a power of two
+#define ROUTE_CACHE_SIZE 256
+
+// Added by dethrace: a bounding volume hierarchy over the path nodes or the path sections, see IndexOppoPaths
+typedef struct tPath_index_node {
+    br_bounds bounds;
+    int first; // first item of a leaf, or first child of an inner node (the second child follows it)
+    int count; // number of items in a leaf, 0 for an inner node
+} tPath_index_node;
+
+typedef struct tPath_index {
+    tPath_index_node* nodes;
+    int number_of_nodes;
+    tS16* items;
+    br_bounds* item_bounds;
+    int number_of_items;
+} tPath_index;
+
+// Added by dethrace: the best candidates so far in an indexed FindNearestGeneralSection
+typedef struct tSection_search {
+    br_vector3* actor_coords;
+    br_scalar closest_distance_squared;
+    tS16 nearest_section;
+    int nearest_end; // twice the section number, plus one for its start node
+    br_vector3* nearest_node_v;
+    br_scalar nearest_node_distance_squared;
+    tS16 nearest_node_section_no;
+    br_scalar nearest_node_t;
+} tSection_search;
+
+// Added by dethrace: a route found by SearchForSection, see FindRouteToSection
+typedef struct tRoute_cache_entry {
+    int generation;
+    tRoute_section start;
+    tS16 target_section;
+    int cheating;
+    int number_of_sections;
+    tRoute_section sections[10];
+} tRoute_cache_entry;
+
 br_actor* gOppo_path_actor;
 br_model* gOppo_path_model;
 br_material* gMat_dk_yel;
@@ -85,6 +132,13 @@ int gProcessing_opponents;
 tU32 gFrame_period_for_this_munging;
 tU32 gTime_stamp_for_this_munging;
 tS16 gMobile_section;
+static tPath_index gNode_index;                           // Added by dethrace
+static tPath_index gSection_index;                        // Added by dethrace
+static int gPath_index_valid;                             // Added by dethrace
+static int gPath_index_axis;                              // Added by dethrace
+static br_bounds* gPath_index_sort_bounds;                // Added by dethrace
+static tRoute_cache_entry gRoute_cache[ROUTE_CACHE_SIZE]; // Added by dethrace
+static int gRoute_cache_generation = 1;                   // Added by dethrace
 
 // IDA: void __usercall PointActorAlongThisBloodyVector(br_actor *pThe_actor@<EAX>, br_vector3 *pThe_vector@<EDX>)
 void PointActorAlongThisBloodyVector(br_actor* pThe_actor, br_vector3* pThe_vector) {
@@ -141,6 +195,21 @@ void ProcessCurrentObjective(tOpponent_spec* pOpponent_spec, tProcess_objective_
     }
 }
 
+// Added by dethrace: drops everything worked out from the paths, they are being loaded or edited
+static void OppoPathsChanged(void) {
+    gPath_index_valid = 0;
+    gRoute_cache_generation++;
+}
+
+// Added by dethrace
+static int OppoPathsBeingEdited(void) {
+    if (gOppo_paths_shown || gAlready_elasticating) {
+        OppoPathsChanged();
+        return 1;
+    }
+    return 0;
+}
+
 // IDA: tS16 __usercall ReallocExtraPathNodes@<AX>(int pHow_many_then@<EAX>)
 tS16 ReallocExtraPathNodes(int pHow_many_then) {
     tPath_node* new_nodes;
@@ -148,6 +217,7 @@ tS16 ReallocExtraPathNodes(int pHow_many_then) {
     LOG_TRACE("(%d)", pHow_many_then);
 
     first_new_node = -1;
+    OppoPathsChanged(); // Added by dethrace
     if (pHow_many_then != 0) {
         first_new_node = gProgram_state.AI_vehicles.number_of_path_nodes;
         new_nodes = BrMemAllocate(sizeof(tPath_node) * (pHow_many_then + gProgram_state.AI_vehicles.number_of_path_nodes), kMem_oppo_new_nodes);
@@ -172,6 +242,7 @@ tS16 ReallocExtraPathSections(int pHow_many_then) {
     LOG_TRACE("(%d)", pHow_many_then);
 
     first_new_section = -1;
+    OppoPathsChanged(); // Added by dethrace
     if (pHow_many_then != 0) {
         first_new_section = gProgram_state.AI_vehicles.number_of_path_sections;
         new_sections = BrMemAllocate(sizeof(tPath_section) * (pHow_many_then + gProgram_state.AI_vehicles.number_of_path_sections), kMem_oppo_new_sections);
@@ -206,6 +277,272 @@ int PointVisibleFromHere(br_vector3* pFrom, br_vector3* pTo) {
     return t > 1.0;
 }
 
+// Added by dethrace: frees a path index, see IndexOppoPaths
+static void DisposePathIndex(tPath_index* pIndex) {
+    if (pIndex->nodes != NULL) {
+        BrMemFree(pIndex->nodes);
+        BrMemFree(pIndex->items);
+        BrMemFree(pIndex->item_bounds);
+    }
+    memset(pIndex, 0, sizeof(tPath_index));
+}
+
+// Added by dethrace
+static void AllocatePathIndex(tPath_index* pIndex, int pNumber_of_items) {
+    DisposePathIndex(pIndex);
+    if (pNumber_of_items == 0) {
+        return;
+    }
+    pIndex->number_of_items = pNumber_of_items;
+    pIndex->items = BrMemAllocate(sizeof(tS16) * pNumber_of_items, kMem_oppo_path_index);
+    pIndex->item_bounds = BrMemAllocate(sizeof(br_bounds) * pNumber_of_items, kMem_oppo_path_index);
+    pIndex->nodes = BrMemAllocate(sizeof(tPath_index_node) * 2 * pNumber_of_items, kMem_oppo_path_index);
+}
+
+// Added by dethrace: orders items along gPath_index_axis by the centres of their bounds
+static int ComparePathIndexItems(const void* p1, const void* p2) {
+    tS16 item1;
+    tS16 item2;
+    br_scalar centre1;
+    br_scalar centre2;
+
+    item1 = *(const tS16*)p1;
+    item2 = *(const tS16*)p2;
+    centre1 = gPath_index_sort_bounds[item1].min.v[gPath_index_axis] + gPath_index_sort_bounds[item1].max.v[gPath_index_axis];
+    centre2 = gPath_index_sort_bounds[item2].min.v[gPath_index_axis] + gPath_index_sort_bounds[item2].max.v[gPath_index_axis];
+    if (centre1 != centre2) {
+        return centre1 < centre2 ? -1 : 1;
+    }
+    return item1 - item2;
+}
+
+// Added by dethrace: builds the node covering pCount items from pFirst, halving them along the longest axis of their
+// bounds until they fit in a leaf
+static void BuildPathIndexNode(tPath_index* pIndex, int pNode, int pFirst, int pCount) {
+    tPath_index_node* node;
+    br_bounds* bounds;
+    br_scalar longest;
+    int child;
+    int i;
+
+    node = &pIndex->nodes[pNode];
+    node->bounds = pIndex->item_bounds[pIndex->items[pFirst]];
+    for (i = pFirst + 1; i < pFirst + pCount; i++) {
+        bounds = &pIndex->item_bounds[pIndex->items[i]];
+        BrVector3Set(&node->bounds.min,
+            MIN(node->bounds.min.v[0], bounds->min.v[0]),
+            MIN(node->bounds.min.v[1], bounds->min.v[1]),
+            MIN(node->bounds.min.v[2], bounds->min.v[2]));
+        BrVector3Set(&node->bounds.max,
+            MAX(node->bounds.max.v[0], bounds->max.v[0]),
+            MAX(node->bounds.max.v[1], bounds->max.v[1]),
+            MAX(node->bounds.max.v[2], bounds->max.v[2]));
+    }
+    if (pCount <= PATH_INDEX_LEAF_SIZE) {
+        node->first = pFirst;
+        node->count = pCount;
+        return;
+    }
+    gPath_index_axis = 0;
+    longest = node->bounds.max.v[0] - node->bounds.min.v[0];
+    for (i = 1; i < 3; i++) {
+        if (node->bounds.max.v[i] - node->bounds.min.v[i] > longest) {
+            longest = node->bounds.max.v[i] - node->bounds.min.v[i];
+            gPath_index_axis = i;
+        }
+    }
+    gPath_index_sort_bounds = pIndex->item_bounds;
+    qsort(&pIndex->items[pFirst], pCount, sizeof(tS16), ComparePathIndexItems);
+    child = pIndex->number_of_nodes;
+    pIndex->number_of_nodes += 2;
+    node->first = child;
+    node->count = 0;
+    BuildPathIndexNode(pIndex, child, pFirst, pCount / 2);
+    BuildPathIndexNode(pIndex, child + 1, pFirst + pCount / 2, pCount - pCount / 2);
+}
+
+// Added by dethrace
+static void BuildPathIndex(tPath_index* pIndex) {
+    int i;
+
+    if (pIndex->number_of_items == 0) {
+        return;
+    }
+    for (i = 0; i < pIndex->number_of_items; i++) {
+        pIndex->items[i] = i;
+    }
+    pIndex->number_of_nodes = 1;
+    BuildPathIndexNode(pIndex, 0, 0, pIndex->number_of_items);
+}
+
+// Added by dethrace: indexes the path nodes and sections for FindNearestPathNode and FindNearestGeneralSection
+static void IndexOppoPaths(void) {
+    int i;
+    br_bounds* bounds;
+    br_vector3* start;
+    br_vector3* finish;
+
+    AllocatePathIndex(&gNode_index, gProgram_state.AI_vehicles.number_of_path_nodes);
+    for (i = 0; i < gNode_index.number_of_items; i++) {
+        bounds = &gNode_index.item_bounds[i];
+        BrVector3Copy(&bounds->min, &gProgram_state.AI_vehicles.path_nodes[i].p);
+        BrVector3Copy(&bounds->max, &gProgram_state.AI_vehicles.path_nodes[i].p);
+    }
+    AllocatePathIndex(&gSection_index, gProgram_state.AI_vehicles.number_of_path_sections);
+    for (i = 0; i < gSection_index.number_of_items; i++) {
+        bounds = &gSection_index.item_bounds[i];
+        start = &gProgram_state.AI_vehicles.path_nodes[gProgram_state.AI_vehicles.path_sections[i].node_indices[0]].p;
+        finish = &gProgram_state.AI_vehicles.path_nodes[gProgram_state.AI_vehicles.path_sections[i].node_indices[1]].p;
+        BrVector3Set(&bounds->min, MIN(start->v[0], finish->v[0]), MIN(start->v[1], finish->v[1]), MIN(start->v[2], finish->v[2]));
+        BrVector3Set(&bounds->max, MAX(start->v[0], finish->v[0]), MAX(start->v[1], finish->v[1]), MAX(start->v[2], finish->v[2]));
+    }
+    BuildPathIndex(&gNode_index);
+    BuildPathIndex(&gSection_index);
+    gPath_index_valid = 1;
+}
+
+// Added by dethrace: the path editor changes the paths in too many ways to keep the indexes up to date, so while it
+// is showing the paths the searches fall back to checking everything, and the indexes are rebuilt once it is done
+static int OppoPathIndexReady(void) {
+    if (OppoPathsBeingEdited()) {
+        return 0;
+    }
+    if (!gPath_index_valid) {
+        IndexOppoPaths();
+    }
+    return 1;
+}
+
+// Added by dethrace: the squared distance from pPoint to pBounds grown by PATH_INDEX_SLACK. Nothing in the bounds is
+// nearer, even allowing for rounding in the distances the searches compare
+static br_scalar PathIndexDistanceSquared(br_bounds* pBounds, br_vector3* pPoint) {
+    br_scalar total;
+    br_scalar d;
+    int i;
+
+    total = 0.f;
+    for (i = 0; i < 3; i++) {
+        if (pPoint->v[i] < pBounds->min.v[i] - PATH_INDEX_SLACK) {
+            d = pBounds->min.v[i] - PATH_INDEX_SLACK - pPoint->v[i];
+        } else if (pPoint->v[i] > pBounds->max.v[i] + PATH_INDEX_SLACK) {
+            d = pPoint->v[i] - pBounds->max.v[i] - PATH_INDEX_SLACK;
+        } else {
+            d = 0.f;
+        }
+        total += d * d;
+    }
+    return total;
+}
+
+// Added by dethrace: FindNearestPathNode's search, visiting the nearer half of the index first. Ties go to the
+// lowest node number, as they do in the full search
+static void SearchPathNodeIndex(int pIndex_node, br_vector3* pActor_coords, tS16* pNearest_node, br_scalar* pDistance) {
+    tPath_index_node* index_node;
+    br_scalar distance;
+    br_scalar child_distance[2];
+    br_vector3 actor_to_node;
+    tS16 node_no;
+    int nearer;
+    int i;
+
+    index_node = &gNode_index.nodes[pIndex_node];
+    if (index_node->count != 0) {
+        for (i = index_node->first; i < index_node->first + index_node->count; i++) {
+            node_no = gNode_index.items[i];
+            BrVector3Sub(&actor_to_node, &gProgram_state.AI_vehicles.path_nodes[node_no].p, pActor_coords);
+            distance = BrVector3Length(&actor_to_node);
+            if (distance < *pDistance || (distance == *pDistance && node_no < *pNearest_node)) {
+                *pDistance = distance;
+                *pNearest_node = node_no;
+            }
+        }
+        return;
+    }
+    child_distance[0] = PathIndexDistanceSquared(&gNode_index.nodes[index_node->first].bounds, pActor_coords);
+    child_distance[1] = PathIndexDistanceSquared(&gNode_index.nodes[index_node->first + 1].bounds, pActor_coords);
+    nearer = child_distance[1] < child_distance[0];
+    if (child_distance[nearer] <= *pDistance * *pDistance) {
+        SearchPathNodeIndex(index_node->first + nearer, pActor_coords, pNearest_node, pDistance);
+    }
+    if (child_distance[!nearer] <= *pDistance * *pDistance) {
+        SearchPathNodeIndex(index_node->first + !nearer, pActor_coords, pNearest_node, pDistance);
+    }
+}
+
+// Added by dethrace: FindNearestGeneralSection's search of the path sections, visiting the nearer half of the index
+// first. Each section is measured exactly as the full search does, and ties go to whichever the full search would
+// have found first
+static void SearchPathSectionIndex(int pIndex_node, tSection_search* pSearch) {
+    tPath_index_node* index_node;
+    br_scalar the_distance_squared;
+    br_scalar length_squared_a;
+    br_scalar t;
+    br_scalar child_distance[2];
+    br_scalar bound;
+    br_vector3 a;
+    br_vector3 p;
+    br_vector3* start;
+    br_vector3* finish;
+    tS16 section_no;
+    int nearer;
+    int i;
+
+    index_node = &gSection_index.nodes[pIndex_node];
+    if (index_node->count != 0) {
+        for (i = index_node->first; i < index_node->first + index_node->count; i++) {
+            section_no = gSection_index.items[i];
+            start = &gProgram_state.AI_vehicles.path_nodes[gProgram_state.AI_vehicles.path_sections[section_no].node_indices[0]].p;
+            finish = &gProgram_state.AI_vehicles.path_nodes[gProgram_state.AI_vehicles.path_sections[section_no].node_indices[1]].p;
+            BrVector3Sub(&a, finish, start);
+            BrVector3Sub(&p, pSearch->actor_coords, start);
+            the_distance_squared = Vector3DistanceSquared(&p, &a);
+            if (the_distance_squared < pSearch->closest_distance_squared
+                || (the_distance_squared == pSearch->closest_distance_squared && 2 * section_no < pSearch->nearest_end)) {
+                pSearch->closest_distance_squared = the_distance_squared;
+                pSearch->nearest_section = section_no;
+                pSearch->nearest_end = 2 * section_no;
+                pSearch->nearest_node_v = finish;
+            }
+            the_distance_squared = BrVector3LengthSquared(&p);
+            if (the_distance_squared < pSearch->closest_distance_squared
+                || (the_distance_squared == pSearch->closest_distance_squared && 2 * section_no + 1 < pSearch->nearest_end)) {
+                pSearch->closest_distance_squared = the_distance_squared;
+                pSearch->nearest_section = section_no;
+                pSearch->nearest_end = 2 * section_no + 1;
+                pSearch->nearest_node_v = start;
+            }
+            length_squared_a = BrVector3LengthSquared(&a);
+            if (length_squared_a >= 0.0001f) {
+                t = BrVector3Dot(&p, &a) / length_squared_a;
+                if (t >= 0 && t <= 1.f) {
+                    p.v[0] -= t * a.v[0];
+                    p.v[1] -= t * a.v[1];
+                    p.v[2] -= t * a.v[2];
+                    the_distance_squared = BrVector3LengthSquared(&p);
+                    if (the_distance_squared < pSearch->nearest_node_distance_squared
+                        || (the_distance_squared == pSearch->nearest_node_distance_squared && section_no < pSearch->nearest_node_section_no)) {
+                        pSearch->nearest_node_distance_squared = the_distance_squared;
+                        pSearch->nearest_node_section_no = section_no;
+                        pSearch->nearest_node_t = t;
+                    }
+                }
+            }
+        }
+        return;
+    }
+    child_distance[0] = PathIndexDistanceSquared(&gSection_index.nodes[index_node->first].bounds, pSearch->actor_coords);
+    child_distance[1] = PathIndexDistanceSquared(&gSection_index.nodes[index_node->first + 1].bounds, pSearch->actor_coords);
+    nearer = child_distance[1] < child_distance[0];
+    bound = MIN(pSearch->closest_distance_squared, pSearch->nearest_node_distance_squared);
+    if (child_distance[nearer] <= bound) {
+        SearchPathSectionIndex(index_node->first + nearer, pSearch);
+    }
+    bound = MIN(pSearch->closest_distance_squared, pSearch->nearest_node_distance_squared);
+    if (child_distance[!nearer] <= bound) {
+        SearchPathSectionIndex(index_node->first + !nearer, pSearch);
+    }
+}
+
 // IDA: tS16 __usercall FindNearestPathNode@<AX>(br_vector3 *pActor_coords@<EAX>, br_scalar *pDistance@<EDX>)
 tS16 FindNearestPathNode(br_vector3* pActor_coords, br_scalar* pDistance) {
     int i;
@@ -216,6 +553,13 @@ tS16 FindNearestPathNode(br_vector3* pActor_coords, br_scalar* pDistance) {
 
     nearest_node = -1;
     *pDistance = FLT_MAX;
+    // Added by dethrace
+    if (OppoPathIndexReady()) {
+        if (gNode_index.number_of_items != 0) {
+            SearchPathNodeIndex(0, pActor_coords, &nearest_node, pDistance);
+        }
+        return nearest_node;
+    }
     for (i = 0; i < gProgram_state.AI_vehicles.number_of_path_nodes; i++) {
         BrVector3Sub(&actor_to_node, &gProgram_state.AI_vehicles.path_nodes[i].p, pActor_coords);
         distance = BrVector3Length(&actor_to_node);
@@ -255,6 +599,7 @@ tS16 FindNearestGeneralSection(tCar_spec* pPursuee, br_vector3* pActor_coords, b
 #if defined(DETHRACE_FIX_BUGS)
     br_vector3 zero_vector;
 #endif
+    tSection_search search; // Added by dethrace
     LOG_TRACE("(%p, %p, %p, %p, %p)", pPursuee, pActor_coords, pPath_direction, pIntersect, pDistance);
 
     nearest_section = -1;
@@ -272,6 +617,34 @@ tS16 FindNearestGeneralSection(tCar_spec* pPursuee, br_vector3* pActor_coords, b
         no_sections = gProgram_state.AI_vehicles.number_of_path_sections;
     }
 
+    // Added by dethrace: search the path sections through their index, finishing off below as the full search does
+    if (pPursuee == NULL && OppoPathIndexReady()) {
+        no_sections = 0;
+        search.actor_coords = pActor_coords;
+        search.closest_distance_squared = closest_distance_squared;
+        search.nearest_section = nearest_section;
+        search.nearest_end = INT_MAX;
+        search.nearest_node_v = nearest_node_v;
+        search.nearest_node_distance_squared = nearest_node_distance_squared;
+        search.nearest_node_section_no = nearest_node_section_no;
+        if (gSection_index.number_of_items != 0) {
+            SearchPathSectionIndex(0, &search);
+        }
+        closest_distance_squared = search.closest_distance_squared;
+        nearest_section = search.nearest_section;
+        nearest_node_v = search.nearest_node_v;
+        nearest_node_distance_squared = search.nearest_node_distance_squared;
+        nearest_node_section_no = search.nearest_node_section_no;
+        if (nearest_node_section_no >= 0) {
+            start = &gProgram_state.AI_vehicles.path_nodes[gProgram_state.AI_vehicles.path_sections[nearest_node_section_no].node_indices[0]].p;
+            finish = &gProgram_state.AI_vehicles.path_nodes[gProgram_state.AI_vehicles.path_sections[nearest_node_section_no].node_indices[1]].p;
+            BrVector3Sub(&a, finish, start);
+            BrVector3Scale(&intersect, &a, search.nearest_node_t);
+            BrVector3Add(pIntersect, start, &intersect);
+            BrVector3NormaliseQuick(pPath_direction, &a);
+        }
+    }
+
     for (section_no = 0; section_no < no_sections; section_no++) {
         if (pPursuee != NULL) {
             start = &pPursuee->my_trail.trail_nodes[section_no];
@@ -597,6 +970,37 @@ int SearchForSection(tRoute_section* pTemp_store, tRoute_section* pPerm_store, i
     return 0;
 }
 
+// Added by dethrace: SearchForSection from pTemp_store[0] to pTarget_section. The search only depends on the paths,
+// so its result is remembered per start, target and cheatiness until the paths change. A pack of opponents heading
+// for the same player keeps asking for the same few routes
+static void FindRouteToSection(tRoute_section* pTemp_store, tRoute_section* pPerm_store, int* pNum_of_perm_store_sections, tS16 pTarget_section, tOpponent_spec* pOpponent_spec) {
+    tRoute_cache_entry* entry;
+    int cheating;
+
+    cheating = pOpponent_spec->cheating != 0;
+    if (OppoPathsBeingEdited()) {
+        SearchForSection(pTemp_store, pPerm_store, pNum_of_perm_store_sections, pTarget_section, 1, 0.f, pOpponent_spec);
+        return;
+    }
+    entry = &gRoute_cache[(pTemp_store[0].section_no * 67 + pTarget_section * 13 + pTemp_store[0].direction * 2 + cheating) & (ROUTE_CACHE_SIZE - 1)];
+    if (entry->generation == gRoute_cache_generation
+        && entry->start.section_no == pTemp_store[0].section_no
+        && entry->start.direction == pTemp_store[0].direction
+        && entry->target_section == pTarget_section
+        && entry->cheating == cheating) {
+        *pNum_of_perm_store_sections = entry->number_of_sections;
+        memcpy(pPerm_store, entry->sections, sizeof(tRoute_section) * entry->number_of_sections);
+        return;
+    }
+    SearchForSection(pTemp_store, pPerm_store, pNum_of_perm_store_sections, pTarget_section, 1, 0.f, pOpponent_spec);
+    entry->generation = gRoute_cache_generation;
+    entry->start = pTemp_store[0];
+    entry->target_section = pTarget_section;
+    entry->cheating = cheating;
+    entry->number_of_sections = *pNum_of_perm_store_sections;
+    memcpy(entry->sections, pPerm_store, sizeof(tRoute_section) * entry->number_of_sections);
+}
+
 // IDA: void __usercall CalcGetNearPlayerRoute(tOpponent_spec *pOpponent_spec@<EAX>, tCar_spec *pPlayer@<EDX>)
 void CalcGetNearPlayerRoute(tOpponent_spec* pOpponent_spec, tCar_spec* pPlayer) {
     int i;
@@ -648,7 +1052,7 @@ void CalcGetNearPlayerRoute(tOpponent_spec* pOpponent_spec, tCar_spec* pPlayer)
         dr_dprintf("%s: CalcGetNearPlayerRoute() - In loop; our section #%d, player's section #%d", pOpponent_spec->car_spec->driver_name, temp_store[0].section_no, players_section);
         gSFS_count++;
         gSFS_cycles_this_time = 0;
-        SearchForSection(temp_store, perm_store, &num_of_perm_store_sections, players_section, 1, 0.f, pOpponent_spec);
+        FindRouteToSection(temp_store, perm_store, &num_of_perm_store_sections, players_section, pOpponent_spec); // Added by dethrace: cached
         gSFS_total_cycles += gSFS_cycles_this_time;
         if (gSFS_max_cycles < gSFS_cycles_this_time) {
             gSFS_max_cycles = gSFS_cycles_this_time;
@@ -697,7 +1101,7 @@ void CalcReturnToStartPointRoute(tOpponent_spec* pOpponent_spec) {
     temp_store[0] = pOpponent_spec->next_sections[pOpponent_spec->nnext_sections - 1];
     gSFS_count++;
     gSFS_cycles_this_time = 0;
-    SearchForSection(temp_store, perm_store, &num_of_perm_store_sections, pOpponent_spec->return_to_start_data.section_no, 1, 0.0f, pOpponent_spec);
+    FindRouteToSection(temp_store, perm_store, &num_of_perm_store_sections, pOpponent_spec->return_to_start_data.section_no, pOpponent_spec); // Added by dethrace: cached
     gSFS_total_cycles += gSFS_cycles_this_time;
     if (gSFS_max_cycles < gSFS_cycles_this_time) {
         gSFS_max_cycles = gSFS_cycles_this_time;
@@ -2249,6 +2653,7 @@ void LoadInOppoPaths(FILE* pF) {
                 gOppo_path_filename);
             PDFatalError(s);
         }
+        IndexOppoPaths(); // Added by dethrace
         if (gAusterity_mode || gNet_mode != eNet_mode_none) {
             gProgram_state.AI_vehicles.number_of_cops = GetAnInt(pF);
             for (j = 0; j < gProgram_state.AI_vehicles.number_of_cops; j++) {
@@ -2310,6 +2715,138 @@ void DisposeOpponentPaths(void) {
     gProgram_state.AI_vehicles.number_of_path_sections = 0;
     gProgram_state.AI_vehicles.path_nodes = NULL;
     gProgram_state.AI_vehicles.path_sections = NULL;
+    // Added by dethrace
+    DisposePathIndex(&gNode_index);
+    DisposePathIndex(&gSection_index);
+    OppoPathsChanged();
+}
+
+// Added by dethrace: with `--ai-budget`, opponents needing no urgent attention wait at least this long (ms) between updates
+#define OPPONENT_INTERVAL_FAR 100
+#define OPPONENT_INTERVAL_IDLE 250
+// Added by dethrace: a deferred opponent catches up on at most this much time (ms) when it is next processed
+#define OPPONENT_MAX_CATCH_UP 500
+
+// Added by dethrace
+typedef struct tOpponent_slot {
+    tOpponent_spec* opponent_spec;
+    tU32* deferred_period;
+    int is_cop;
+    int overdue;
+} tOpponent_slot;
+
+// Added by dethrace: frame time each opponent and cop has missed while deferred by MungeOpponentsWithinBudget
+static tU32 gOpponent_deferred_period[COUNT_OF(gProgram_state.AI_vehicles.opponents)];
+static tU32 gCop_deferred_period[COUNT_OF(gProgram_state.AI_vehicles.cops)];
+
+// Added by dethrace
+// 0 when the opponent must be processed this frame: it is in view, has been told to rethink or a murder was reported to it
+static tU32 OpponentUpdateInterval(tOpponent_spec* pOpponent_spec) {
+    if (pOpponent_spec->new_objective_required || pOpponent_spec->murder_reported || pOpponent_spec->player_to_oppo_d < gIn_view_distance) {
+        return 0;
+    }
+    if (pOpponent_spec->current_objective == eOOT_frozen || pOpponent_spec->current_objective == eOOT_wait_for_some_hapless_sod) {
+        return OPPONENT_INTERVAL_IDLE;
+    }
+    return OPPONENT_INTERVAL_FAR;
+}
+
+// Added by dethrace
+// Run the expensive half of an opponent's update over all the frame time it missed while deferred
+static void ProcessOpponentSlot(tOpponent_slot* pSlot, tU32 pFrame_period) {
+    tU32 period;
+
+    period = pFrame_period;
+    if (*pSlot->deferred_period != 0) {
+        period = MAX(pFrame_period, MIN(pFrame_period + *pSlot->deferred_period, OPPONENT_MAX_CATCH_UP));
+    }
+    gFrame_period_for_this_munging = period;
+    gFrame_period_for_this_munging_in_secs = period / 1000.f;
+    CalcPlayerConspicuousness(pSlot->opponent_spec);
+    ProcessThisOpponent(pSlot->opponent_spec);
+    ClearTwattageOccurrenceVariables(pSlot->opponent_spec);
+    if (pSlot->is_cop) {
+        pSlot->opponent_spec->murder_reported = 0;
+    }
+    pSlot->opponent_spec->time_last_processed = gTime_stamp_for_this_munging;
+    *pSlot->deferred_period = 0;
+}
+
+// Added by dethrace
+// Time-sliced replacement for the per-opponent loops of MungeOpponents. Opponents the player can see are processed every
+// frame as before, the rest share `opponent_ai_budget` microseconds, most overdue first. A deferred opponent keeps its
+// last controls so physics still drives it, and its next update sees the whole elapsed period
+static void MungeOpponentsWithinBudget(tU32 pFrame_period, int pUn_stun_flag) {
+    tOpponent_slot slots[COUNT_OF(gOpponent_deferred_period) + COUNT_OF(gCop_deferred_period)];
+    tOpponent_slot* due[COUNT_OF(slots)];
+    tOpponent_slot* slot;
+    tU32 interval;
+    uint64_t start;
+    int number_of_slots;
+    int number_due;
+    int processed;
+    int i;
+    int j;
+
+    start = OS_GetMicroseconds();
+    number_of_slots = 0;
+    for (i = 0; i < gProgram_state.AI_vehicles.number_of_opponents; i++) {
+        if (!gProgram_state.AI_vehicles.opponents[i].finished_for_this_race) {
+            slot = &slots[number_of_slots++];
+            slot->opponent_spec = &gProgram_state.AI_vehicles.opponents[i];
+            slot->deferred_period = &gOpponent_deferred_period[i];
+            slot->is_cop = 0;
+        }
+    }
+    for (i = 0; i < gNumber_of_cops_before_faffage; i++) {
+        if (!gProgram_state.AI_vehicles.cops[i].finished_for_this_race) {
+            slot = &slots[number_of_slots++];
+            slot->opponent_spec = &gProgram_state.AI_vehicles.cops[i];
+            slot->deferred_period = &gCop_deferred_period[i];
+            slot->is_cop = 1;
+        }
+    }
+
+    // urgent opponents first, in the original order
+    number_due = 0;
+    for (i = 0; i < number_of_slots; i++) {
+        slot = &slots[i];
+        if (pUn_stun_flag) {
+            UnStunTheBugger(slot->opponent_spec);
+        }
+        if (slot->is_cop) {
+            CalcDistanceFromHome(slot->opponent_spec);
+        }
+        CalcOpponentConspicuousnessWithAViewToCheatingLikeFuck(slot->opponent_spec);
+        interval = OpponentUpdateInterval(slot->opponent_spec);
+        if (interval == 0) {
+            ProcessOpponentSlot(slot, pFrame_period);
+            continue;
+        }
+        slot->overdue = (int)(gTime_stamp_for_this_munging - (slot->opponent_spec->time_last_processed + interval));
+        if (slot->overdue < 0) {
+            *slot->deferred_period += pFrame_period;
+            continue;
+        }
+        for (j = number_due; j > 0 && due[j - 1]->overdue < slot->overdue; j--) {
+            due[j] = due[j - 1];
+        }
+        due[j] = slot;
+        number_due++;
+    }
+
+    // then whoever has waited longest, while there is time left. At least one per frame so nobody starves
+    processed = 0;
+    for (i = 0; i < number_due; i++) {
+        if (processed == 0 || OS_GetMicroseconds() - start < (uint64_t)harness_game_config.opponent_ai_budget) {
+            ProcessOpponentSlot(due[i], pFrame_period);
+            processed++;
+        } else {
+            *due[i]->deferred_period += pFrame_period;
+        }
+    }
+    gFrame_period_for_this_munging = pFrame_period;
+    gFrame_period_for_this_munging_in_secs = pFrame_period / 1000.f;
 }
 
 // IDA: void __usercall MungeOpponents(tU32 pFrame_period@<EAX>)
@@ -2360,28 +2897,33 @@ void MungeOpponents(tU32 pFrame_period) {
                 }
             }
         }
-        for (i = 0; i < gProgram_state.AI_vehicles.number_of_opponents; i++) {
-            if (!gProgram_state.AI_vehicles.opponents[i].finished_for_this_race) {
-                if (un_stun_flag) {
-                    UnStunTheBugger(&gProgram_state.AI_vehicles.opponents[i]);
+        if (harness_game_config.opponent_ai_budget > 0) {
+            // Added by dethrace
+            MungeOpponentsWithinBudget(pFrame_period, un_stun_flag);
+        } else {
+            for (i = 0; i < gProgram_state.AI_vehicles.number_of_opponents; i++) {
+                if (!gProgram_state.AI_vehicles.opponents[i].finished_for_this_race) {
+                    if (un_stun_flag) {
+                        UnStunTheBugger(&gProgram_state.AI_vehicles.opponents[i]);
+                    }
+                    CalcOpponentConspicuousnessWithAViewToCheatingLikeFuck(&gProgram_state.AI_vehicles.opponents[i]);
+                    CalcPlayerConspicuousness(&gProgram_state.AI_vehicles.opponents[i]);
+                    ProcessThisOpponent(&gProgram_state.AI_vehicles.opponents[i]);
+                    ClearTwattageOccurrenceVariables(&gProgram_state.AI_vehicles.opponents[i]);
                 }
-                CalcOpponentConspicuousnessWithAViewToCheatingLikeFuck(&gProgram_state.AI_vehicles.opponents[i]);
-                CalcPlayerConspicuousness(&gProgram_state.AI_vehicles.opponents[i]);
-                ProcessThisOpponent(&gProgram_state.AI_vehicles.opponents[i]);
-                ClearTwattageOccurrenceVariables(&gProgram_state.AI_vehicles.opponents[i]);
             }
-        }
-        for (i = 0; i < gNumber_of_cops_before_faffage; i++) {
-            if (!gProgram_state.AI_vehicles.cops[i].finished_for_this_race) {
-                if (un_stun_flag) {
-                    UnStunTheBugger(&gProgram_state.AI_vehicles.cops[i]);
+            for (i = 0; i < gNumber_of_cops_before_faffage; i++) {
+                if (!gProgram_state.AI_vehicles.cops[i].finished_for_this_race) {
+                    if (un_stun_flag) {
+                        UnStunTheBugger(&gProgram_state.AI_vehicles.cops[i]);
+                    }
+                    CalcDistanceFromHome(&gProgram_state.AI_vehicles.cops[i]);
+                    CalcOpponentConspicuousnessWithAViewToCheatingLikeFuck(&gProgram_state.AI_vehicles.cops[i]);
+                    CalcPlayerConspicuousness(&gProgram_state.AI_vehicles.cops[i]);
+                    ProcessThisOpponent(&gProgram_state.AI_vehicles.cops[i]);
+                    ClearTwattageOccurrenceVariables(&gProgram_state.AI_vehicles.cops[i]);
+                    gProgram_state.AI_vehicles.cops[i].murder_reported = 0;
                 }
-                CalcDistanceFromHome(&gProgram_state.AI_vehicles.cops[i]);
-                CalcOpponentConspicuousnessWithAViewToCheatingLikeFuck(&gProgram_state.AI_vehicles.cops[i]);
-                CalcPlayerConspicuousness(&gProgram_state.AI_vehicles.cops[i]);
-                ProcessThisOpponent(&gProgram_state.AI_vehicles.cops[i]);
-                ClearTwattageOccurrenceVariables(&gProgram_state.AI_vehicles.cops[i]);
-                gProgram_state.AI_vehicles.cops[i].murder_reported = 0;
             }
         }
         if (gNext_grudge_reduction < gTime_stamp_for_this_munging) {
@@ -2471,6 +3013,7 @@ void InitOpponents(tRace_info* pRace_info) {
             gProgram_state.AI_vehicles.opponents[i].car_spec->car_ID);
         gProgram_state.AI_vehicles.opponents[i].index = pRace_info->opponent_list[opponent_number].index;
         gProgram_state.AI_vehicles.opponents[i].time_last_processed = gTime_stamp_for_this_munging;
+        gOpponent_deferred_period[i] = 0; // Added by dethrace
         gProgram_state.AI_vehicles.opponents[i].time_this_objective_started = gTime_stamp_for_this_munging;
         gProgram_state.AI_vehicles.opponents[i].last_moved_ok = gTime_stamp_for_this_munging;
         gProgram_state.AI_vehicles.opponents[i].last_in_view = 0;
@@ -2521,6 +3064,7 @@ void InitOpponents(tRace_info* pRace_info) {
         gProgram_state.AI_vehicles.cops[i].car_spec->car_ID = i | 0x300;
         gProgram_state.AI_vehicles.cops[i].index = 3;
         gProgram_state.AI_vehicles.cops[i].time_last_processed = gTime_stamp_for_this_munging;
+        gCop_deferred_period[i] = 0; // Added by dethrace
         gProgram_state.AI_vehicles.cops[i].time_this_objective_started = gTime_stamp_for_this_munging;
         gProgram_state.AI_vehicles.cops[i].last_moved_ok = gTime_stamp_for_this_munging;
         gProgram_state.AI_vehicles.cops[i].last_in_view = 0;
@@ -3139,6 +3683,7 @@ void DeleteSection(tS16 pSection_to_delete) {
     tS16 found_it;
     LOG_TRACE("(%d)", pSection_to_delete);
 
+    OppoPathsChanged(); // Added by dethrace
     for (node_no = 0; node_no < 2; node_no++) {
         node_no_index = gProgram_state.AI_vehicles.path_sections[pSection_to_delete].node_indices[node_no];
         if (node_no_index >= 0) {
@@ -3177,6 +3722,7 @@ void DeleteNode(tS16 pNode_to_delete, int pAnd_sections) {
     tS16 section2;
     LOG_TRACE("(%d, %d)", pNode_to_delete, pAnd_sections);
 
+    OppoPathsChanged(); // Added by dethrace
     dr_dprintf("Node to be deleted #%d", pNode_to_delete);
     if (pAnd_sections) {
         while (gProgram_state.AI_vehicles.path_nodes[pNode_to_delete].number_of_sections != 0) {
@@ -3830,6 +4376,7 @@ void ShowOppoPaths(void) {
     char str[256];
     LOG_TRACE("()");
 
+    OppoPathsChanged(); // Added by dethrace
     if (!gOppo_paths_shown) {
         if (gOppo_path_actor != NULL) {
             gOppo_path_actor->render_style = BR_RSTYLE_NONE;
@@ -7,7 +7,10 @@
 #include "globvars.h"
 #include "globvrpb.h"
 #include "graphics.h"
+#include "harness/config.h"
 #include "harness/trace.h"
+#include "harness/writer.h"
+#include "loading.h"
 #include "oil.h"
 #include "opponent.h"
 #include "pedestrn.h"
@@ -18,6 +21,7 @@
 #include "sys.h"
 #include "utility.h"
 #include "world.h"
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -91,7 +95,84 @@ tU8* gLocal_buffer;
 tU32 gLocal_buffer_size;
 tPipe_chunk* gIncidentChunk; // FIXME: added by DethRace (really needed?)
 
+// Added by dethrace: the frame boundaries in the pipe in recording order, oldest first. Entries for sessions that
+// have since been overwritten are dropped lazily
+typedef struct tPipe_frame_index_entry {
+    tU32 sequence;
+    tU32 time;
+} tPipe_frame_index_entry;
+
+static tU32 gPipe_next_sequence;
+static tU32 gLast_sequence_of_type[ePipe_chunk_enum_count];
+static tU32 gLast_offset_of_type[ePipe_chunk_enum_count];
+static tPipe_frame_index_entry* gFrame_index;
+static int gFrame_index_capacity;
+static int gFrame_index_first;
+static int gFrame_index_count;
+
+// Added by dethrace: a car chunk ready to add to a session, and the last one piped for each car
+typedef struct tEncoded_car {
+    int subject_index;
+    tU32 size;
+    union {
+        tPipe_car_data full;
+        tPipe_packed_car_data packed;
+    } data;
+} tEncoded_car;
+
+typedef struct tLast_piped_car {
+    tEncoded_car encoded;
+    int frames_skipped;
+} tLast_piped_car;
+
 #define LOCAL_BUFFER_SIZE 15000
+#define FRAME_INDEX_INITIAL_CAPACITY 1024
+
+// Car chunk subject index bits above the car ID: set when the chunk is a tPipe_packed_car_data, and which quaternion
+// component was left out of it
+#define PIPE_CAR_PACKED 0x4000
+#define PIPE_CAR_DROPPED_SHIFT 12
+#define PIPE_CAR_DROPPED_MASK 0x3000
+// The largest quaternion component is left out, so the rest lie within +/- sqrt(1/2)
+#define PIPE_CAR_ROTATION_SCALE (32767.f * 1.41421356f)
+// A matrix further than one quantisation step from orthonormal would not come back close to itself, so is piped in full
+#define PIPE_CAR_ROTATION_TOLERANCE (1.f / PIPE_CAR_ROTATION_SCALE)
+// An unchanged car is still piped at least this often, so there is always a recent chunk to rewind to
+#define PIPE_CAR_REFRESH_FRAMES 16
+#define PIPED_CARS_PER_CATEGORY 16
+
+static tLast_piped_car gLast_piped_cars[eVehicle_not_really][PIPED_CARS_PER_CATEGORY];
+// The cars' matrices when the action replay was entered. Leaving it applies the last car chunks, whose rotations are
+// rounded, so these are put back to carry on the race from exactly where it stopped
+static br_matrix34 gLive_car_mats[eVehicle_not_really][PIPED_CARS_PER_CATEGORY];
+
+// Added by dethrace: action replay in net games. Every client waits while the host replays, so the pipe is kept short
+// enough to rewind through quickly, and effects that nothing else depends on are left out of a frame that has already
+// piped its share
+#define NET_PIPE_BUFFER_SIZE (2 * 1024 * 1024)
+#define NET_PIPE_FRAME_BUDGET 4096
+
+static int gNet_frame_piped_bytes;
+static int gNet_sessions_shed;
+
+// Added by dethrace: recorded replays, see `--record-replays` and `--play-replay`
+#define RECORDED_REPLAY_MAGIC 0x50525244 // "DRRP"
+#define RECORDED_REPLAY_VERSION 1
+// Sessions are written as they are laid out in memory, so only a build that lays them out alike can read them
+#define RECORDED_REPLAY_LAYOUT (offsetof(tPipe_session, chunks) | sizeof(tPipe_chunk) << 8 | sizeof(void*) << 24)
+// A recorded replay is played by another run of the game, so the pointers in its chunks are written as tokens naming
+// what they point to, and turned back into pointers as it is loaded
+#define REPLAY_TOKEN_NONE 0
+#define REPLAY_TOKEN_DONT_RENDER 1
+#define REPLAY_TOKEN_CAR 0x10000          // | car ID
+#define REPLAY_TOKEN_NON_CAR 0x20000      // | non-car ID
+#define REPLAY_TOKEN_OIL_PIXIE 0x30000    // | index in gOil_pixies
+#define REPLAY_TOKEN_SHRAPNEL 0x40000     // | car ID << 2 | index in that car's shrapnel_material
+#define REPLAY_TOKEN_KIND_MASK 0xffff0000
+#define NON_CAR_ID_COUNT 1000
+
+static tHarness_writer* gReplay_writer;
+static br_actor* gRecorded_non_car_actors[NON_CAR_ID_COUNT];
 
 #if defined(DETHRACE_REPLAY_DEBUG)
 #define REPLAY_DEBUG_CHUNK_MAGIC1 0x1ed6ef85
@@ -237,7 +318,15 @@ tU32 LengthOfSession(tPipe_session* pSession) {
         running_total = SIZEOF_CHUNK(frame_boundary_data);
         break;
     case ePipe_chunk_car:
-        running_total = SIZEOF_CHUNK(car_data) * pSession->number_of_chunks;
+        running_total = 0;
+        for (i = 0; i < pSession->number_of_chunks; i++) {
+            the_chunk = (tPipe_chunk*)&((tU8*)&pSession->chunks)[running_total];
+            if (the_chunk->subject_index & PIPE_CAR_PACKED) {
+                running_total += SIZEOF_CHUNK(packed_car_data);
+            } else {
+                running_total += SIZEOF_CHUNK(car_data);
+            }
+        }
         break;
     case ePipe_chunk_sound:
         running_total = SIZEOF_CHUNK(sound_data) * pSession->number_of_chunks;
@@ -316,6 +405,302 @@ tU32 LengthOfSession(tPipe_session* pSession) {
     return running_total;
 }
 
+// Added by dethrace: whether the session numbered `pSequence` is still in the pipe
+static int PipedSessionIsLive(tU32 pSequence) {
+
+    return pSequence != 0 && gPipe_buffer_oldest != NULL && pSequence >= ((tPipe_session*)gPipe_buffer_oldest)->sequence;
+}
+
+// Added by dethrace
+static void AddToFrameIndex(tU32 pSequence, tU32 pTime) {
+    tPipe_frame_index_entry* bigger;
+    int i;
+
+    while (gFrame_index_count != 0 && !PipedSessionIsLive(gFrame_index[gFrame_index_first].sequence)) {
+        gFrame_index_first = (gFrame_index_first + 1) % gFrame_index_capacity;
+        gFrame_index_count--;
+    }
+    if (gFrame_index_count == gFrame_index_capacity) {
+        bigger = BrMemAllocate(2 * gFrame_index_capacity * sizeof(tPipe_frame_index_entry), kMem_pipe_frame_index);
+        for (i = 0; i < gFrame_index_count; i++) {
+            bigger[i] = gFrame_index[(gFrame_index_first + i) % gFrame_index_capacity];
+        }
+        BrMemFree(gFrame_index);
+        gFrame_index = bigger;
+        gFrame_index_capacity *= 2;
+        gFrame_index_first = 0;
+    }
+    gFrame_index[(gFrame_index_first + gFrame_index_count) % gFrame_index_capacity].sequence = pSequence;
+    gFrame_index[(gFrame_index_first + gFrame_index_count) % gFrame_index_capacity].time = pTime;
+    gFrame_index_count++;
+}
+
+// Added by dethrace
+static tCar_spec* RecordedCar(int pCar_ID) {
+    int cat;
+    int i;
+
+    cat = (pCar_ID & 0x0f00) >> 8;
+    i = pCar_ID & 0xff;
+    if (cat == eVehicle_self) {
+        return &gProgram_state.current_car;
+    }
+    if (cat >= eVehicle_not_really || i >= GetCarCount(cat)) {
+        return NULL;
+    }
+    return GetCarSpec(cat, i);
+}
+
+// Added by dethrace: the number non-car actors are named with, or -1 when `pActor` is not a non-car
+static int NonCarID(br_actor* pActor) {
+    int i;
+
+    if (pActor->identifier == NULL || pActor->identifier[0] != '&' || strlen(pActor->identifier) < 8) {
+        return -1;
+    }
+    for (i = 5; i < 8; i++) {
+        if (pActor->identifier[i] < '0' || pActor->identifier[i] > '9') {
+            return -1;
+        }
+    }
+    return 100 * (pActor->identifier[5] - '0') + 10 * (pActor->identifier[6] - '0') + 1 * (pActor->identifier[7] - '0');
+}
+
+// Added by dethrace
+static void FindNonCarActors(br_actor* pActor) {
+    br_actor* child;
+    int id;
+
+    for (child = pActor->children; child != NULL; child = child->next) {
+        id = NonCarID(child);
+        if (id >= 0 && gRecorded_non_car_actors[id] == NULL) {
+            gRecorded_non_car_actors[id] = child;
+        }
+        FindNonCarActors(child);
+    }
+}
+
+// Added by dethrace
+static tU32 ActorToken(br_actor* pActor) {
+    tCar_spec* car;
+    int cat;
+    int i;
+    int car_count;
+
+    if (pActor == NULL) {
+        return REPLAY_TOKEN_NONE;
+    }
+    if (pActor == gDont_render_actor) {
+        return REPLAY_TOKEN_DONT_RENDER;
+    }
+    for (cat = eVehicle_self; cat < eVehicle_not_really; cat++) {
+        car_count = cat == eVehicle_self ? 1 : GetCarCount(cat);
+        for (i = 0; i < car_count; i++) {
+            car = cat == eVehicle_self ? &gProgram_state.current_car : GetCarSpec(cat, i);
+            if (car->car_master_actor == pActor) {
+                return REPLAY_TOKEN_CAR | car->car_ID;
+            }
+        }
+    }
+    if (NonCarID(pActor) >= 0) {
+        return REPLAY_TOKEN_NON_CAR | NonCarID(pActor);
+    }
+    return REPLAY_TOKEN_NONE;
+}
+
+// Added by dethrace
+static br_actor* TokenActor(tU32 pToken) {
+    tCar_spec* car;
+
+    switch (pToken & REPLAY_TOKEN_KIND_MASK) {
+    case REPLAY_TOKEN_CAR:
+        car = RecordedCar(pToken & 0xffff);
+        return car != NULL ? car->car_master_actor : NULL;
+    case REPLAY_TOKEN_NON_CAR:
+        return (pToken & 0xffff) < NON_CAR_ID_COUNT ? gRecorded_non_car_actors[pToken & 0xffff] : NULL;
+    default:
+        return pToken == REPLAY_TOKEN_DONT_RENDER ? gDont_render_actor : NULL;
+    }
+}
+
+// Added by dethrace
+static tU32 ShrapnelMaterialToken(br_material* pMaterial) {
+    tCar_spec* car;
+    int cat;
+    int i;
+    int j;
+    int car_count;
+
+    for (cat = eVehicle_self; cat < eVehicle_not_really; cat++) {
+        car_count = cat == eVehicle_self ? 1 : GetCarCount(cat);
+        for (i = 0; i < car_count; i++) {
+            car = cat == eVehicle_self ? &gProgram_state.current_car : GetCarSpec(cat, i);
+            for (j = 0; j < car->max_shrapnel_material && j < (int)COUNT_OF(car->shrapnel_material); j++) {
+                if (car->shrapnel_material[j] == pMaterial) {
+                    return REPLAY_TOKEN_SHRAPNEL | car->car_ID << 2 | j;
+                }
+            }
+        }
+    }
+    return REPLAY_TOKEN_NONE;
+}
+
+// Added by dethrace
+static br_material* TokenShrapnelMaterial(tU32 pToken) {
+    tCar_spec* car;
+
+    if ((pToken & REPLAY_TOKEN_KIND_MASK) != REPLAY_TOKEN_SHRAPNEL) {
+        return NULL;
+    }
+    car = RecordedCar((pToken & 0xffff) >> 2);
+    if (car == NULL || (int)(pToken & 3) >= car->max_shrapnel_material) {
+        return NULL;
+    }
+    return car->shrapnel_material[pToken & 3];
+}
+
+// Added by dethrace: swap the pointers in `pSession` for tokens, or the tokens back for pointers
+static void TranslateSessionPointers(tPipe_session* pSession, int pTo_tokens) {
+    tPipe_chunk* chunk;
+    tU8* pushed_end_of_session;
+    tCar_spec* car;
+    int i;
+
+#define TOKEN_OF(PTR) ((tU32)(uintptr_t)(PTR))
+#define AS_TOKEN(TOKEN) ((void*)(uintptr_t)(TOKEN))
+
+    pushed_end_of_session = gEnd_of_session;
+    gEnd_of_session = (tU8*)pSession + LengthOfSession(pSession) - sizeof(tU16);
+    chunk = &pSession->chunks;
+    for (i = 0; i < pSession->number_of_chunks; i++) {
+        switch (pSession->chunk_type) {
+        case ePipe_chunk_pedestrian:
+            // only there for dead pedestrians, see AddPedestrianToPipingSession
+            if (chunk->chunk_data.pedestrian_data.hit_points <= 0) {
+                if (pTo_tokens) {
+                    chunk->chunk_data.pedestrian_data.parent_actor = AS_TOKEN(ActorToken(chunk->chunk_data.pedestrian_data.parent_actor));
+                } else {
+                    chunk->chunk_data.pedestrian_data.parent_actor = TokenActor(TOKEN_OF(chunk->chunk_data.pedestrian_data.parent_actor));
+                    if (chunk->chunk_data.pedestrian_data.parent_actor == NULL) {
+                        chunk->chunk_data.pedestrian_data.parent_actor = gDont_render_actor;
+                    }
+                }
+            }
+            break;
+        case ePipe_chunk_incident:
+            if (chunk->subject_index == eIncident_ped) {
+                if (pTo_tokens) {
+                    chunk->chunk_data.incident_data.info.ped_info.actor = AS_TOKEN(ActorToken(chunk->chunk_data.incident_data.info.ped_info.actor));
+                } else {
+                    chunk->chunk_data.incident_data.info.ped_info.actor = TokenActor(TOKEN_OF(chunk->chunk_data.incident_data.info.ped_info.actor));
+                }
+            }
+            break;
+        case ePipe_chunk_shrapnel:
+            // only there for new shrapnel, see AdvanceChunkPtr
+            if (chunk->subject_index & 0x8000) {
+                if (pTo_tokens) {
+                    chunk->chunk_data.shrapnel_data.material = AS_TOKEN(ShrapnelMaterialToken(chunk->chunk_data.shrapnel_data.material));
+                } else {
+                    chunk->chunk_data.shrapnel_data.material = TokenShrapnelMaterial(TOKEN_OF(chunk->chunk_data.shrapnel_data.material));
+                }
+            }
+            break;
+        case ePipe_chunk_non_car:
+            if (pTo_tokens) {
+                chunk->chunk_data.non_car_data.actor = AS_TOKEN(ActorToken(chunk->chunk_data.non_car_data.actor));
+            } else {
+                chunk->chunk_data.non_car_data.actor = TokenActor(TOKEN_OF(chunk->chunk_data.non_car_data.actor));
+            }
+            break;
+        case ePipe_chunk_oil_spill:
+            if (pTo_tokens) {
+                car = chunk->chunk_data.oil_data.car;
+                chunk->chunk_data.oil_data.car = AS_TOKEN(car != NULL ? REPLAY_TOKEN_CAR | car->car_ID : REPLAY_TOKEN_NONE);
+                chunk->chunk_data.oil_data.pixelmap = AS_TOKEN(chunk->chunk_data.oil_data.pixelmap == gOil_pixies[0] ? REPLAY_TOKEN_OIL_PIXIE : REPLAY_TOKEN_NONE);
+            } else {
+                car = NULL;
+                if ((TOKEN_OF(chunk->chunk_data.oil_data.car) & REPLAY_TOKEN_KIND_MASK) == REPLAY_TOKEN_CAR) {
+                    car = RecordedCar(TOKEN_OF(chunk->chunk_data.oil_data.car) & 0xffff);
+                }
+                chunk->chunk_data.oil_data.car = car;
+                chunk->chunk_data.oil_data.pixelmap = TOKEN_OF(chunk->chunk_data.oil_data.pixelmap) == REPLAY_TOKEN_OIL_PIXIE ? gOil_pixies[0] : NULL;
+            }
+            break;
+        default:
+            break;
+        }
+        AdvanceChunkPtr(&chunk, pSession->chunk_type);
+    }
+    gEnd_of_session = pushed_end_of_session;
+
+#undef TOKEN_OF
+#undef AS_TOKEN
+}
+
+// Added by dethrace: whether EndPipingSession2 should leave out `pSession` to keep a net game's frame within
+// NET_PIPE_FRAME_BUDGET
+static int ShedFromNetFrame(tPipe_session* pSession, int pSize) {
+    if (gNet_mode == eNet_mode_none || pSession->number_of_chunks == 0) {
+        return 0;
+    }
+    if (pSession->chunk_type == ePipe_chunk_frame_boundary) {
+        gNet_frame_piped_bytes = 0;
+        return 0;
+    }
+    if (gNet_frame_piped_bytes + pSize > NET_PIPE_FRAME_BUDGET
+        && (pSession->chunk_type == ePipe_chunk_spark
+            || pSession->chunk_type == ePipe_chunk_smoke
+            || pSession->chunk_type == ePipe_chunk_screen_shake)) {
+        gNet_sessions_shed++;
+        return 1;
+    }
+    gNet_frame_piped_bytes += pSize;
+    return 0;
+}
+
+// Added by dethrace: write the session EndPipingSession2 has just piped to the replay being recorded. `pSize` leaves
+// out the length at its end, which is added again as it is loaded
+static void RecordLocalSession(tU32 pSize) {
+    TranslateSessionPointers((tPipe_session*)gLocal_buffer, 1);
+    Harness_Writer_Write(gReplay_writer, &pSize, sizeof(pSize));
+    Harness_Writer_Write(gReplay_writer, gLocal_buffer, pSize);
+    // so a crash loses at most the frame it happened in
+    if (((tPipe_session*)gLocal_buffer)->chunk_type == ePipe_chunk_frame_boundary) {
+        Harness_Writer_Flush(gReplay_writer);
+    }
+}
+
+// Added by dethrace: start streaming the race's sessions to a new REPLAYnnn.RPL, see `--record-replays`
+static void StartRecordingReplay(void) {
+    tRecorded_replay_header header;
+    tPath_name the_path;
+    int i;
+
+    if (!FindUniqueReplayFile(the_path)) {
+        LOG_WARN("No free REPLAYnnn.RPL name left, not recording this race");
+        return;
+    }
+    gReplay_writer = Harness_Writer_Open(the_path);
+    if (gReplay_writer == NULL) {
+        LOG_WARN("Could not create \"%s\", not recording this race", the_path);
+        return;
+    }
+    memset(&header, 0, sizeof(header));
+    header.magic = RECORDED_REPLAY_MAGIC;
+    header.version = RECORDED_REPLAY_VERSION;
+    header.layout = RECORDED_REPLAY_LAYOUT;
+    header.race_index = gProgram_state.current_race_index;
+    header.car_index = gProgram_state.current_car_index;
+    strncpy(header.car_name, gProgram_state.car_name, sizeof(header.car_name) - 1);
+    header.number_of_racers = MIN(gCurrent_race.number_of_racers, (int)COUNT_OF(header.opponent_indices));
+    for (i = 0; i < header.number_of_racers; i++) {
+        header.opponent_indices[i] = gCurrent_race.opponent_list[i].index;
+    }
+    Harness_Writer_Write(gReplay_writer, &header, sizeof(header));
+    LOG_INFO("Recording the action replay to \"%s\"", the_path);
+}
+
 // IDA: void __usercall StartPipingSession2(tPipe_chunk_type pThe_type@<EAX>, int pMunge_reentrancy@<EDX>)
 void StartPipingSession2(tPipe_chunk_type pThe_type, int pMunge_reentrancy) {
     LOG_TRACE("(%d, %d)", pThe_type, pMunge_reentrancy);
@@ -342,12 +727,14 @@ void StartPipingSession2(tPipe_chunk_type pThe_type, int pMunge_reentrancy) {
 void StartPipingSession(tPipe_chunk_type pThe_type) {
     LOG_TRACE("(%d)", pThe_type);
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     StartPipingSession2(pThe_type, 1);
 }
 
 // IDA: void __usercall EndPipingSession2(int pMunge_reentrancy@<EAX>)
 void EndPipingSession2(int pMunge_reentrancy) {
     int a;
+    tPipe_session* session;
     LOG_TRACE("(%d)", pMunge_reentrancy);
 
     if (gPipe_buffer_start != NULL && !gAction_replay_mode && gProgram_state.racing) {
@@ -360,6 +747,10 @@ void EndPipingSession2(int pMunge_reentrancy) {
         gLocal_buffer_size = PIPE_ALIGN(gLocal_buffer_size);
         *(tU16*)&gLocal_buffer[gLocal_buffer_size - sizeof(tU16)] = gLocal_buffer_size - sizeof(tU16);
 #endif
+        // Added by dethrace
+        if (ShedFromNetFrame((tPipe_session*)gLocal_buffer, gLocal_buffer_size)) {
+            ((tPipe_session*)gLocal_buffer)->number_of_chunks = 0;
+        }
         if (((tPipe_session*)gLocal_buffer)->number_of_chunks != 0 && (gLocal_buffer_size < LOCAL_BUFFER_SIZE || a == LOCAL_BUFFER_SIZE - 2)) {
             if (gPipe_buffer_phys_end < gPipe_record_ptr + gLocal_buffer_size) {
                 // Put session at begin of pipe, as no place at end
@@ -382,11 +773,29 @@ void EndPipingSession2(int pMunge_reentrancy) {
             if (gPipe_buffer_oldest == NULL) {
                 gPipe_buffer_oldest = gPipe_record_ptr;
             }
+            // Added by dethrace: link the session to the last one of its type, see FindPreviousChunk
+            session = (tPipe_session*)gLocal_buffer;
+            session->sequence = gPipe_next_sequence++;
+            if (gLast_sequence_of_type[session->chunk_type] != 0 && session->sequence - gLast_sequence_of_type[session->chunk_type] <= 0xffff) {
+                session->previous_of_type_distance = session->sequence - gLast_sequence_of_type[session->chunk_type];
+            } else {
+                session->previous_of_type_distance = 0;
+            }
+            session->previous_of_type_offset = gLast_offset_of_type[session->chunk_type];
+            gLast_sequence_of_type[session->chunk_type] = session->sequence;
+            gLast_offset_of_type[session->chunk_type] = gPipe_record_ptr - gPipe_buffer_start;
             memcpy(gPipe_record_ptr, gLocal_buffer, gLocal_buffer_size);
             gPipe_record_ptr += gLocal_buffer_size;
             if (gPipe_buffer_working_end < gPipe_record_ptr) {
                 gPipe_buffer_working_end = gPipe_record_ptr;
             }
+            if (session->chunk_type == ePipe_chunk_frame_boundary) {
+                AddToFrameIndex(session->sequence, session->chunks.chunk_data.frame_boundary_data.time);
+            }
+            // Added by dethrace
+            if (gReplay_writer != NULL) {
+                RecordLocalSession(a);
+            }
         }
         if (pMunge_reentrancy) {
             if (gReentrancy_count != 0) {
@@ -403,6 +812,7 @@ void EndPipingSession2(int pMunge_reentrancy) {
 void EndPipingSession(void) {
     LOG_TRACE("()");
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     EndPipingSession2(1);
 }
 
@@ -590,6 +1000,7 @@ void AddSplashToPipingSession(tCollision_info* pCar) {
     tPipe_splash_data data;
     LOG_TRACE("(%p)", pCar);
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     if (pCar->driver >= eDriver_oppo) {
         data.d = pCar->water_d;
         BrVector3Copy(&data.normal, &pCar->water_normal);
@@ -622,21 +1033,169 @@ void AddFrameFinishToPipingSession(tU32 pThe_time) {
     AddDataToSession(0, &data, sizeof(tPipe_frame_boundary_data));
 }
 
+// Added by dethrace: pack the rotation in `pMat` into the three smallest components of its quaternion, returning which
+// one was left out, or -1 when `pMat` is not a rotation and has to be piped in full
+static int PackCarRotation(tS16* pRotation, br_matrix34* pMat) {
+    float q[4];
+    float s;
+    float sign;
+    br_vector3 cross;
+    int dropped;
+    int i;
+    int j;
+    int k;
+
+    for (i = 0; i < 3; i++) {
+        for (j = i; j < 3; j++) {
+            s = pMat->m[i][0] * pMat->m[j][0] + pMat->m[i][1] * pMat->m[j][1] + pMat->m[i][2] * pMat->m[j][2];
+            if (fabsf(s - (i == j ? 1.f : 0.f)) > PIPE_CAR_ROTATION_TOLERANCE) {
+                return -1;
+            }
+        }
+    }
+    BrVector3Cross(&cross, (br_vector3*)pMat->m[0], (br_vector3*)pMat->m[1]);
+    if (BrVector3Dot(&cross, (br_vector3*)pMat->m[2]) <= 0.f) {
+        return -1;
+    }
+    s = pMat->m[0][0] + pMat->m[1][1] + pMat->m[2][2];
+    if (s > 0.f) {
+        s = 2.f * sqrtf(s + 1.f);
+        q[3] = .25f * s;
+        q[0] = (pMat->m[2][1] - pMat->m[1][2]) / s;
+        q[1] = (pMat->m[0][2] - pMat->m[2][0]) / s;
+        q[2] = (pMat->m[1][0] - pMat->m[0][1]) / s;
+    } else if (pMat->m[0][0] > pMat->m[1][1] && pMat->m[0][0] > pMat->m[2][2]) {
+        s = 2.f * sqrtf(1.f + pMat->m[0][0] - pMat->m[1][1] - pMat->m[2][2]);
+        q[3] = (pMat->m[2][1] - pMat->m[1][2]) / s;
+        q[0] = .25f * s;
+        q[1] = (pMat->m[0][1] + pMat->m[1][0]) / s;
+        q[2] = (pMat->m[0][2] + pMat->m[2][0]) / s;
+    } else if (pMat->m[1][1] > pMat->m[2][2]) {
+        s = 2.f * sqrtf(1.f + pMat->m[1][1] - pMat->m[0][0] - pMat->m[2][2]);
+        q[3] = (pMat->m[0][2] - pMat->m[2][0]) / s;
+        q[0] = (pMat->m[0][1] + pMat->m[1][0]) / s;
+        q[1] = .25f * s;
+        q[2] = (pMat->m[1][2] + pMat->m[2][1]) / s;
+    } else {
+        s = 2.f * sqrtf(1.f + pMat->m[2][2] - pMat->m[0][0] - pMat->m[1][1]);
+        q[3] = (pMat->m[1][0] - pMat->m[0][1]) / s;
+        q[0] = (pMat->m[0][2] + pMat->m[2][0]) / s;
+        q[1] = (pMat->m[1][2] + pMat->m[2][1]) / s;
+        q[2] = .25f * s;
+    }
+    dropped = 0;
+    for (i = 1; i < 4; i++) {
+        if (fabsf(q[i]) > fabsf(q[dropped])) {
+            dropped = i;
+        }
+    }
+    // q and -q are the same rotation, so the left out component is always taken as positive
+    sign = q[dropped] < 0.f ? -1.f : 1.f;
+    for (i = 0, k = 0; i < 4; i++) {
+        if (i != dropped) {
+            pRotation[k++] = (tS16)MAX(-32767.f, MIN(32767.f, sign * q[i] * PIPE_CAR_ROTATION_SCALE + (q[i] * sign >= 0.f ? .5f : -.5f)));
+        }
+    }
+    return dropped;
+}
+
+// Added by dethrace
+static void UnpackCarRotation(br_matrix34* pMat, tS16* pRotation, int pDropped) {
+    float q[4];
+    float sum;
+    int i;
+    int k;
+
+    sum = 0.f;
+    for (i = 0, k = 0; i < 4; i++) {
+        if (i != pDropped) {
+            q[i] = pRotation[k++] / PIPE_CAR_ROTATION_SCALE;
+            sum += q[i] * q[i];
+        }
+    }
+    q[pDropped] = sqrtf(MAX(0.f, 1.f - sum));
+    pMat->m[0][0] = 1.f - 2.f * (q[1] * q[1] + q[2] * q[2]);
+    pMat->m[0][1] = 2.f * (q[0] * q[1] - q[2] * q[3]);
+    pMat->m[0][2] = 2.f * (q[0] * q[2] + q[1] * q[3]);
+    pMat->m[1][0] = 2.f * (q[0] * q[1] + q[2] * q[3]);
+    pMat->m[1][1] = 1.f - 2.f * (q[0] * q[0] + q[2] * q[2]);
+    pMat->m[1][2] = 2.f * (q[1] * q[2] - q[0] * q[3]);
+    pMat->m[2][0] = 2.f * (q[0] * q[2] - q[1] * q[3]);
+    pMat->m[2][1] = 2.f * (q[1] * q[2] + q[0] * q[3]);
+    pMat->m[2][2] = 1.f - 2.f * (q[0] * q[0] + q[1] * q[1]);
+}
+
+// Added by dethrace: the chunk AddCarToPipingSession would add, packed when the car's matrix is a plain rotation
+static void EncodeCar(tEncoded_car* pEncoded, int pCar_ID, br_matrix34* pCar_mat, br_vector3* pCar_velocity, float pSpeedo_speed, float pLf_sus_position, float pRf_sus_position, float pLr_sus_position, float pRr_sus_position, float pSteering_angle, br_scalar pRevs, int pGear, int pFrame_coll_flag) {
+    tPipe_car_data* data;
+    tPipe_packed_car_data* packed;
+    tS16 rotation[3];
+    int dropped;
+
+    // compared byte for byte to find unchanged cars, so the padding must be zero too
+    memset(pEncoded, 0, sizeof(tEncoded_car));
+    dropped = PackCarRotation(rotation, pCar_mat);
+    if (dropped < 0) {
+        data = &pEncoded->data.full;
+        BrMatrix34Copy(&data->transformation, pCar_mat);
+        BrVector3Copy(&data->velocity, pCar_velocity);
+        data->speedo_speed = pSpeedo_speed * 32767.f / 0.07f;
+        data->lf_sus_position = pLf_sus_position * 127.f / .15f;
+        data->rf_sus_position = pRf_sus_position * 127.f / .15f;
+        data->lr_sus_position = pLr_sus_position * 127.f / .15f;
+        data->rr_sus_position = pRr_sus_position * 127.f / .15f;
+        data->steering_angle = pSteering_angle * 32767.f / 60.f;
+        data->revs_and_gear = (pGear + 1) << 12 | (pFrame_coll_flag ? 0 : 1) << 11 | ((((int)pRevs) / 10) & 0x7ff);
+        pEncoded->subject_index = pCar_ID;
+        pEncoded->size = sizeof(tPipe_car_data);
+    } else {
+        packed = &pEncoded->data.packed;
+        BrVector3Copy(&packed->position, (br_vector3*)pCar_mat->m[3]);
+        BrVector3Copy(&packed->velocity, pCar_velocity);
+        memcpy(packed->rotation, rotation, sizeof(rotation));
+        packed->speedo_speed = pSpeedo_speed * 32767.f / 0.07f;
+        packed->lf_sus_position = pLf_sus_position * 127.f / .15f;
+        packed->rf_sus_position = pRf_sus_position * 127.f / .15f;
+        packed->lr_sus_position = pLr_sus_position * 127.f / .15f;
+        packed->rr_sus_position = pRr_sus_position * 127.f / .15f;
+        packed->steering_angle = pSteering_angle * 32767.f / 60.f;
+        packed->revs_and_gear = (pGear + 1) << 12 | (pFrame_coll_flag ? 0 : 1) << 11 | ((((int)pRevs) / 10) & 0x7ff);
+        pEncoded->subject_index = pCar_ID | PIPE_CAR_PACKED | (dropped << PIPE_CAR_DROPPED_SHIFT);
+        pEncoded->size = sizeof(tPipe_packed_car_data);
+    }
+}
+
+// Added by dethrace: the car data in `pChunk`, unpacked into `pUnpacked` if need be
+static tPipe_car_data* CarChunkData(tPipe_chunk* pChunk, tPipe_car_data* pUnpacked) {
+    tPipe_packed_car_data* packed;
+
+    if (!(pChunk->subject_index & PIPE_CAR_PACKED)) {
+        return &pChunk->chunk_data.car_data;
+    }
+    packed = &pChunk->chunk_data.packed_car_data;
+    UnpackCarRotation(&pUnpacked->transformation, packed->rotation, (pChunk->subject_index & PIPE_CAR_DROPPED_MASK) >> PIPE_CAR_DROPPED_SHIFT);
+    BrVector3Copy((br_vector3*)pUnpacked->transformation.m[3], &packed->position);
+    BrVector3Copy(&pUnpacked->velocity, &packed->velocity);
+    pUnpacked->speedo_speed = packed->speedo_speed;
+    pUnpacked->steering_angle = packed->steering_angle;
+    pUnpacked->revs_and_gear = packed->revs_and_gear;
+    pUnpacked->lf_sus_position = packed->lf_sus_position;
+    pUnpacked->rf_sus_position = packed->rf_sus_position;
+    pUnpacked->lr_sus_position = packed->lr_sus_position;
+    pUnpacked->rr_sus_position = packed->rr_sus_position;
+    return pUnpacked;
+}
+
 // IDA: void __usercall AddCarToPipingSession(int pCar_ID@<EAX>, br_matrix34 *pCar_mat@<EDX>, br_vector3 *pCar_velocity@<EBX>, float pSpeedo_speed, float pLf_sus_position, float pRf_sus_position, float pLr_sus_position, float pRr_sus_position, float pSteering_angle, br_scalar pRevs, int pGear, int pFrame_coll_flag)
 void AddCarToPipingSession(int pCar_ID, br_matrix34* pCar_mat, br_vector3* pCar_velocity, float pSpeedo_speed, float pLf_sus_position, float pRf_sus_position, float pLr_sus_position, float pRr_sus_position, float pSteering_angle, br_scalar pRevs, int pGear, int pFrame_coll_flag) {
-    tPipe_car_data data;
+    tEncoded_car encoded;
     LOG_TRACE("(%d, %p, %p, %f, %f, %f, %f, %f, %f, %f, %d, %d)", pCar_ID, pCar_mat, pCar_velocity, pSpeedo_speed, pLf_sus_position, pRf_sus_position, pLr_sus_position, pRr_sus_position, pSteering_angle, pRevs, pGear, pFrame_coll_flag);
 
-    BrMatrix34Copy(&data.transformation, pCar_mat);
-    BrVector3Copy(&data.velocity, pCar_velocity);
-    data.speedo_speed = pSpeedo_speed * 32767.f / 0.07f;
-    data.lf_sus_position = pLf_sus_position * 127.f / .15f;
-    data.rf_sus_position = pRf_sus_position * 127.f / .15f;
-    data.lr_sus_position = pLr_sus_position * 127.f / .15f;
-    data.rr_sus_position = pRr_sus_position * 127.f / .15f;
-    data.steering_angle = pSteering_angle * 32767.f / 60.f;
-    data.revs_and_gear = (pGear + 1) << 12 | (pFrame_coll_flag ? 0 : 1) << 11 | ((((int)pRevs) / 10) & 0x7ff);
-    AddDataToSession(pCar_ID, &data, sizeof(tPipe_car_data));
+    // Added by dethrace: packed when possible, see EncodeCar
+    EncodeCar(&encoded, pCar_ID, pCar_mat, pCar_velocity, pSpeedo_speed,
+        pLf_sus_position, pRf_sus_position, pLr_sus_position, pRr_sus_position,
+        pSteering_angle, pRevs, pGear, pFrame_coll_flag);
+    AddDataToSession(encoded.subject_index, &encoded.data, encoded.size);
 }
 
 // IDA: void __usercall AddSoundToPipingSession(tS3_outlet_ptr pOutlet@<EAX>, int pSound_index@<EDX>, tS3_volume pL_volume@<EBX>, tS3_volume pR_volume@<ECX>, tS3_pitch pPitch, br_vector3 *pPos)
@@ -912,27 +1471,51 @@ void ResetPiping(void) {
     gPipe_record_ptr = gPipe_buffer_start;
     gPipe_buffer_working_end = gPipe_buffer_phys_end;
     gReentrancy_count = 0;
+    // Added by dethrace
+    gPipe_next_sequence = 1;
+    memset(gLast_sequence_of_type, 0, sizeof(gLast_sequence_of_type));
+    memset(gLast_offset_of_type, 0, sizeof(gLast_offset_of_type));
+    gFrame_index_first = 0;
+    gFrame_index_count = 0;
+    memset(gLast_piped_cars, 0, sizeof(gLast_piped_cars));
+    gNet_frame_piped_bytes = 0;
 }
 
 // IDA: void __cdecl InitialisePiping()
 void InitialisePiping(void) {
     LOG_TRACE("()");
 
-    if (!gAusterity_mode && gNet_mode == eNet_mode_none) {
+    // Added by dethrace: the host of a net game can replay it too, pausing everyone as ToggleReplay does. A client
+    // cannot, as it would stop sending its car
+    if (!gAusterity_mode && gNet_mode != eNet_mode_client) {
         PDAllocateActionReplayBuffer((char**)&gPipe_buffer_start, &gPipe_buffer_size);
+        // Added by dethrace
+        if (gNet_mode != eNet_mode_none && gPipe_buffer_size > NET_PIPE_BUFFER_SIZE) {
+            gPipe_buffer_size = NET_PIPE_BUFFER_SIZE;
+        }
         gPipe_buffer_phys_end = gPipe_buffer_start + gPipe_buffer_size;
         gSmudge_space = BrMemAllocate(offsetof(tPipe_smudge_data, vertex_changes) + sizeof(tSmudged_vertex) * 2400, kMem_pipe_model_geometry);
         // DAT_00532008 = 0;
         BrVector3SetFloat(&gZero_vector, 0.f, 0.f, 0.f);
         gModel_geometry_space = (tPipe_model_geometry_data*)gSmudge_space;
         gLocal_buffer = BrMemAllocate(LOCAL_BUFFER_SIZE, kMem_pipe_model_geometry);
+        // Added by dethrace
+        gFrame_index_capacity = FRAME_INDEX_INITIAL_CAPACITY;
+        gFrame_index = BrMemAllocate(gFrame_index_capacity * sizeof(tPipe_frame_index_entry), kMem_pipe_frame_index);
     } else {
         gPipe_buffer_start = NULL;
         gLocal_buffer = NULL;
         gModel_geometry_space = NULL;
         gSmudge_space = NULL;
+        gFrame_index = NULL;
     }
     ResetPiping();
+    // Added by dethrace
+    gNet_sessions_shed = 0;
+    // a recorded replay names the grid of a race started from the menus, which a net race is not
+    if (gPipe_buffer_start != NULL && gNet_mode == eNet_mode_none && harness_game_config.record_replays && harness_game_config.play_replay_path[0] == '\0') {
+        StartRecordingReplay();
+    }
 }
 
 // IDA: void __cdecl DisposePiping()
@@ -951,6 +1534,20 @@ void DisposePiping(void) {
         BrMemFree(gLocal_buffer);
         gLocal_buffer = NULL;
     }
+    // Added by dethrace
+    if (gFrame_index != NULL) {
+        BrMemFree(gFrame_index);
+        gFrame_index = NULL;
+    }
+    if (gReplay_writer != NULL) {
+        if (!Harness_Writer_Close(gReplay_writer)) {
+            LOG_WARN("Some of the recorded replay could not be written");
+        }
+        gReplay_writer = NULL;
+    }
+    if (gNet_sessions_shed != 0) {
+        LOG_INFO("Left %d effect sessions out of the action replay to keep within its net frame budget", gNet_sessions_shed);
+    }
 }
 
 // IDA: void __cdecl InitLastDamageArrayEtc()
@@ -1019,6 +1616,8 @@ void PipeCarPositions(void) {
     int session_started;
     int difference_found;
     tS8 damage_deltas[12];
+    tEncoded_car encoded;
+    tLast_piped_car* last;
     LOG_TRACE("()");
 
     StartPipingSession(ePipe_chunk_car);
@@ -1034,10 +1633,22 @@ void PipeCarPositions(void) {
             } else {
                 car = GetCarSpec(cat, i);
             }
-            AddCarToPipingSession((cat << 8) | i,
+            // Added by dethrace: leave out a car that has not changed since it was last piped. Rewinding over
+            // the frames without it finds that last chunk, which is the state it stayed in
+            EncodeCar(&encoded, (cat << 8) | i,
                 &car->car_master_actor->t.t.mat, &car->v, car->speedo_speed,
                 car->lf_sus_position, car->rf_sus_position, car->lr_sus_position, car->rr_sus_position,
                 car->steering_angle, car->revs, car->gear, car->frame_collision_flag);
+            last = i < PIPED_CARS_PER_CATEGORY ? &gLast_piped_cars[cat][i] : NULL;
+            if (last != NULL && last->frames_skipped < PIPE_CAR_REFRESH_FRAMES - 1 && memcmp(&last->encoded, &encoded, sizeof(tEncoded_car)) == 0) {
+                last->frames_skipped++;
+                continue;
+            }
+            AddDataToSession(encoded.subject_index, &encoded.data, encoded.size);
+            if (last != NULL) {
+                last->encoded = encoded;
+                last->frames_skipped = 0;
+            }
         }
     }
     EndPipingSession();
@@ -1124,7 +1735,7 @@ void AdvanceChunkPtr(tPipe_chunk** pChunk, tChunk_subject_index pType) {
         *(tU8**)pChunk += sizeof(tPipe_frame_boundary_data);
         break;
     case ePipe_chunk_car:
-        *(tU8**)pChunk += sizeof(tPipe_car_data);
+        *(tU8**)pChunk += (((*pChunk)->subject_index & PIPE_CAR_PACKED) ? sizeof(tPipe_packed_car_data) : sizeof(tPipe_car_data));
         break;
     case ePipe_chunk_sound:
         *(tU8**)pChunk += sizeof(tPipe_sound_data);
@@ -1312,8 +1923,11 @@ void ApplyGrooveStop(tPipe_chunk** pChunk) {
 void ApplyNonCar(tPipe_chunk** pChunk) {
     LOG_TRACE("(%p)", pChunk);
 
-    AdjustNonCar((*pChunk)->chunk_data.non_car_data.actor,
-        &(*pChunk)->chunk_data.non_car_data.mat);
+    // Added by dethrace: NULL in a recorded replay that names a non-car this track does not have
+    if ((*pChunk)->chunk_data.non_car_data.actor != NULL) {
+        AdjustNonCar((*pChunk)->chunk_data.non_car_data.actor,
+            &(*pChunk)->chunk_data.non_car_data.mat);
+    }
     AdvanceChunkPtr(pChunk, ePipe_chunk_non_car);
 }
 
@@ -1440,15 +2054,19 @@ void ApplyCar(tPipe_chunk** pChunk) {
     tCar_spec* car;
     br_vector3 com_offset_c;
     br_vector3 com_offset_w;
+    tPipe_car_data* data;
+    tPipe_car_data unpacked;
     LOG_TRACE("(%p)", pChunk);
 
-    if (((*pChunk)->subject_index & 0xff00) == 0) {
+    // Added by dethrace: the bits above 0x0fff say how the chunk is packed
+    if (((*pChunk)->subject_index & 0x0f00) == 0) {
         car = &gProgram_state.current_car;
     } else {
-        car = GetCarSpec((*pChunk)->subject_index >> 8, (*pChunk)->subject_index & 0x00ff);
+        car = GetCarSpec(((*pChunk)->subject_index & 0x0fff) >> 8, (*pChunk)->subject_index & 0x00ff);
     }
-    BrMatrix34Copy(&car->car_master_actor->t.t.mat, &(*pChunk)->chunk_data.car_data.transformation);
-    BrVector3Copy(&car->v, &(*pChunk)->chunk_data.car_data.velocity);
+    data = CarChunkData(*pChunk, &unpacked);
+    BrMatrix34Copy(&car->car_master_actor->t.t.mat, &data->transformation);
+    BrVector3Copy(&car->v, &data->velocity);
     BrMatrix34TApplyV(&car->velocity_car_space, &car->v, &car->car_master_actor->t.t.mat);
     BrVector3InvScale(&car->velocity_car_space, &car->velocity_car_space, WORLD_SCALE);
     if (BrVector3LengthSquared(&car->velocity_car_space) >= .0001f) {
@@ -1460,15 +2078,15 @@ void ApplyCar(tPipe_chunk** pChunk) {
     BrVector3InvScale(&com_offset_c, &car->cmpos, WORLD_SCALE);
     BrMatrix34ApplyV(&com_offset_w, &com_offset_c, &car->car_master_actor->t.t.mat);
     BrVector3Accumulate(&car->pos, &com_offset_w);
-    car->speedo_speed = .07f * (*pChunk)->chunk_data.car_data.speedo_speed / 32767.f;
-    car->lf_sus_position = 0.15f * (*pChunk)->chunk_data.car_data.lf_sus_position / 127.f;
-    car->rf_sus_position = 0.15f * (*pChunk)->chunk_data.car_data.rf_sus_position / 127.f;
-    car->lr_sus_position = 0.15f * (*pChunk)->chunk_data.car_data.lr_sus_position / 127.f;
-    car->rr_sus_position = 0.15f * (*pChunk)->chunk_data.car_data.rr_sus_position / 127.f;
-    car->steering_angle = 60.f * (*pChunk)->chunk_data.car_data.steering_angle / 32767.f;
-    car->revs = 10 * ((*pChunk)->chunk_data.car_data.revs_and_gear & 0x7ff);
-    car->gear = ((*pChunk)->chunk_data.car_data.revs_and_gear >> 12) - 1;
-    car->frame_collision_flag = ((*pChunk)->chunk_data.car_data.revs_and_gear >> 11) & 0x1;
+    car->speedo_speed = .07f * data->speedo_speed / 32767.f;
+    car->lf_sus_position = 0.15f * data->lf_sus_position / 127.f;
+    car->rf_sus_position = 0.15f * data->rf_sus_position / 127.f;
+    car->lr_sus_position = 0.15f * data->lr_sus_position / 127.f;
+    car->rr_sus_position = 0.15f * data->rr_sus_position / 127.f;
+    car->steering_angle = 60.f * data->steering_angle / 32767.f;
+    car->revs = 10 * (data->revs_and_gear & 0x7ff);
+    car->gear = (data->revs_and_gear >> 12) - 1;
+    car->frame_collision_flag = (data->revs_and_gear >> 11) & 0x1;
     AdvanceChunkPtr(pChunk, ePipe_chunk_car);
 }
 
@@ -1682,6 +2300,33 @@ int MoveSessionPointerForwardOne(tU8** pPtr) {
     return *pPtr == gPipe_record_ptr;
 }
 
+// Added by dethrace: FindPreviousChunk for a session of the type being searched for. Rather than stepping back
+// through every session, follow the links to the earlier sessions of that type, stopping at the same places
+static tPipe_chunk* FindPreviousChunkOfSameType(tPipe_session* pSession, tChunk_subject_index pIndex) {
+    tPipe_session* session;
+    tPipe_session* later;
+    tPipe_chunk* mr_chunky;
+    tU32 sequence;
+    int i;
+
+    for (later = pSession; later->previous_of_type_distance != 0; later = session) {
+        sequence = later->sequence - later->previous_of_type_distance;
+        if (!PipedSessionIsLive(sequence) || pSession->sequence - sequence > (tU32)gMax_rewind_chunks) {
+            break;
+        }
+        session = (tPipe_session*)(gPipe_buffer_start + later->previous_of_type_offset);
+        gEnd_of_session = (tU8*)session + LengthOfSession(session) - sizeof(tU16);
+        mr_chunky = &session->chunks;
+        for (i = 0; i < session->number_of_chunks; i++) {
+            if ((mr_chunky->subject_index & 0xfff) == (pIndex & 0x0fff)) {
+                return mr_chunky;
+            }
+            AdvanceChunkPtr(&mr_chunky, session->chunk_type);
+        }
+    }
+    return NULL;
+}
+
 // IDA: tPipe_chunk* __usercall FindPreviousChunk@<EAX>(tU8 *pPtr@<EAX>, tPipe_chunk_type pType@<EDX>, tChunk_subject_index pIndex@<EBX>)
 tPipe_chunk* FindPreviousChunk(tU8* pPtr, tPipe_chunk_type pType, tChunk_subject_index pIndex) {
     tU8* ptr;
@@ -1692,6 +2337,10 @@ tPipe_chunk* FindPreviousChunk(tU8* pPtr, tPipe_chunk_type pType, tChunk_subject
     tChunk_subject_index masked_index;
     LOG_TRACE("(%p, %d, %d)", pPtr, pType, pIndex);
 
+    // Added by dethrace
+    if (pPtr != gPipe_record_ptr && ((tPipe_session*)pPtr)->chunk_type == pType) {
+        return FindPreviousChunkOfSameType((tPipe_session*)pPtr, pIndex);
+    }
     ptr = pPtr;
     chunk_counter = 0;
     masked_index = pIndex & 0x0fff;
@@ -2112,15 +2761,38 @@ int UndoPipedSession(tU8** pPtr) {
 // IDA: tU32 __usercall FindPrevFrameTime@<EAX>(tU8 *pPtr@<EAX>)
 tU32 FindPrevFrameTime(tU8* pPtr) {
     tU8* temp_ptr;
+    tU32 sequence;
+    int low;
+    int high;
+    int middle;
+    tPipe_frame_index_entry* entry;
     LOG_TRACE("(%p)", pPtr);
 
-    temp_ptr = pPtr;
-    do {
-        if (MoveSessionPointerBackOne(&temp_ptr)) {
-            return 0;
+    // Added by dethrace: binary search the frame index for the last frame boundary recorded before pPtr,
+    // instead of stepping back a session at a time
+    if (pPtr == gPipe_record_ptr) {
+        sequence = gPipe_next_sequence;
+    } else {
+        sequence = ((tPipe_session*)pPtr)->sequence;
+    }
+    low = 0;
+    high = gFrame_index_count;
+    while (low < high) {
+        middle = (low + high) / 2;
+        if (gFrame_index[(gFrame_index_first + middle) % gFrame_index_capacity].sequence < sequence) {
+            low = middle + 1;
+        } else {
+            high = middle;
         }
-    } while (((tPipe_session*)temp_ptr)->chunk_type != ePipe_chunk_frame_boundary);
-    return ((tPipe_session*)temp_ptr)->chunks.chunk_data.frame_boundary_data.time;
+    }
+    if (low == 0) {
+        return 0;
+    }
+    entry = &gFrame_index[(gFrame_index_first + low - 1) % gFrame_index_capacity];
+    if (!PipedSessionIsLive(entry->sequence)) {
+        return 0;
+    }
+    return entry->time;
 }
 
 // IDA: void __usercall ScanBuffer(tU8 **pPtr@<EAX>, tPipe_chunk_type pType@<EDX>, tU32 pDefault_time@<EBX>, int (*pCall_back)(tPipe_chunk*, int, tU32)@<ECX>, int (*pTime_check)(tU32))
@@ -2182,6 +2854,8 @@ int CheckCar(tPipe_chunk* pChunk_ptr, int pChunk_count, tU32 pTime) {
     br_vector3 com_offset_w;
     br_vector3 difference;
     tPipe_chunk* temp_ptr;
+    tPipe_car_data* data;
+    tPipe_car_data unpacked;
     LOG_TRACE("(%p, %d, %d)", pChunk_ptr, pChunk_count, pTime);
 
     temp_ptr = pChunk_ptr;
@@ -2195,15 +2869,16 @@ int CheckCar(tPipe_chunk* pChunk_ptr, int pChunk_count, tU32 pTime) {
         }
     }
     for (i = 0; i < pChunk_count; i++) {
-        if ((temp_ptr->subject_index & 0xff00) == 0) {
+        if ((temp_ptr->subject_index & 0x0f00) == 0) {
             car = &gProgram_state.current_car;
         } else {
-            car = GetCarSpec(temp_ptr->subject_index >> 8, temp_ptr->subject_index & 0xff);
+            car = GetCarSpec((temp_ptr->subject_index & 0x0fff) >> 8, temp_ptr->subject_index & 0xff);
         }
         if (car == gCar_ptr) {
-            BrVector3Copy(&gCar_pos, (br_vector3*)temp_ptr->chunk_data.car_data.transformation.m[3]);
+            data = CarChunkData(temp_ptr, &unpacked);
+            BrVector3Copy(&gCar_pos, (br_vector3*)data->transformation.m[3]);
             BrVector3InvScale(&com_offset_c, &car->cmpos, WORLD_SCALE);
-            BrMatrix34ApplyV(&com_offset_w, &com_offset_c, &temp_ptr->chunk_data.car_data.transformation);
+            BrMatrix34ApplyV(&com_offset_w, &com_offset_c, &data->transformation);
             BrVector3Accumulate(&gCar_pos, &com_offset_w);
             BrVector3Sub(&difference, &gCar_pos, &gReference_pos);
             if (BrVector3LengthSquared(&difference) <= gMax_distance) {
@@ -2328,3 +3003,128 @@ tU32 GetARStartTime(void) {
     } while (((tPipe_session*)temp_ptr)->chunk_type != ePipe_chunk_frame_boundary);
     return ((tPipe_session*)temp_ptr)->chunks.chunk_data.frame_boundary_data.time;
 }
+
+// Added by dethrace: the race a replay written by `--record-replays` was recorded in. Returns 0 when `pPath` is not
+// such a replay, or one this build cannot read
+int ReadRecordedReplayHeader(char* pPath, tRecorded_replay_header* pHeader) {
+    FILE* f;
+    int ok;
+
+    f = DRfopen(pPath, "rb");
+    if (f == NULL) {
+        LOG_WARN("Could not open the recorded replay \"%s\"", pPath);
+        return 0;
+    }
+    ok = fread(pHeader, sizeof(tRecorded_replay_header), 1, f) == 1
+        && pHeader->magic == RECORDED_REPLAY_MAGIC
+        && pHeader->version == RECORDED_REPLAY_VERSION
+        && pHeader->layout == RECORDED_REPLAY_LAYOUT
+        && pHeader->number_of_racers >= 0 && pHeader->number_of_racers <= (int)COUNT_OF(pHeader->opponent_indices);
+    fclose(f);
+    if (!ok) {
+        LOG_WARN("\"%s\" is not a replay recorded by this build", pPath);
+        return 0;
+    }
+    pHeader->car_name[sizeof(pHeader->car_name) - 1] = '\0';
+    return 1;
+}
+
+// Added by dethrace: pipe the sessions of a replay written by `--record-replays` as though they had just been raced,
+// once the race it was recorded in has been loaded. When there are more than the pipe holds, the oldest are dropped as
+// they would have been during the race. `pEnd_time` is set to the time of the last frame
+int LoadRecordedReplay(char* pPath, tU32* pEnd_time) {
+    FILE* f;
+    tRecorded_replay_header header;
+    tPipe_session* session;
+    tU32 size;
+    int session_count;
+
+    *pEnd_time = 0;
+    if (gPipe_buffer_start == NULL || gReplay_writer != NULL) {
+        return 0;
+    }
+    f = DRfopen(pPath, "rb");
+    if (f == NULL || fread(&header, sizeof(header), 1, f) != 1) {
+        if (f != NULL) {
+            fclose(f);
+        }
+        return 0;
+    }
+    memset(gRecorded_non_car_actors, 0, sizeof(gRecorded_non_car_actors));
+    FindNonCarActors(gUniverse_actor);
+    ResetPiping();
+    session = (tPipe_session*)gLocal_buffer;
+    session_count = 0;
+    while (fread(&size, sizeof(size), 1, f) == 1) {
+        if (size < offsetof(tPipe_session, chunks) || size > LOCAL_BUFFER_SIZE - sizeof(tU16)
+            || fread(gLocal_buffer, size, 1, f) != 1
+            || session->chunk_type >= ePipe_chunk_enum_count
+            || LengthOfSession(session) != size + sizeof(tU16)) {
+            LOG_WARN("\"%s\" is damaged after %d sessions, playing those", pPath, session_count);
+            break;
+        }
+        TranslateSessionPointers(session, 0);
+        gLocal_buffer_size = size;
+        EndPipingSession2(0);
+        if (session->chunk_type == ePipe_chunk_frame_boundary) {
+            *pEnd_time = session->chunks.chunk_data.frame_boundary_data.time;
+        }
+        session_count++;
+    }
+    fclose(f);
+    LOG_INFO("Loaded %d sessions from \"%s\"", session_count, pPath);
+    return *pEnd_time != 0;
+}
+
+// Added by dethrace: see gLive_car_mats
+void SaveLiveCarMatrices(void) {
+    tCar_spec* car;
+    int cat;
+    int i;
+    int car_count;
+
+    for (cat = eVehicle_self; cat < eVehicle_not_really; cat++) {
+        car_count = MIN(GetCarCount(cat), PIPED_CARS_PER_CATEGORY);
+        for (i = 0; i < car_count; i++) {
+            if (cat == eVehicle_self) {
+                car = &gProgram_state.current_car;
+            } else {
+                car = GetCarSpec(cat, i);
+            }
+            BrMatrix34Copy(&gLive_car_mats[cat][i], &car->car_master_actor->t.t.mat);
+        }
+    }
+}
+
+// Added by dethrace: put back the matrices SaveLiveCarMatrices kept, and what ApplyCar works out from them
+void RestoreLiveCarMatrices(void) {
+    tCar_spec* car;
+    br_vector3 com_offset_c;
+    br_vector3 com_offset_w;
+    int cat;
+    int i;
+    int car_count;
+
+    for (cat = eVehicle_self; cat < eVehicle_not_really; cat++) {
+        car_count = MIN(GetCarCount(cat), PIPED_CARS_PER_CATEGORY);
+        for (i = 0; i < car_count; i++) {
+            if (cat == eVehicle_self) {
+                car = &gProgram_state.current_car;
+            } else {
+                car = GetCarSpec(cat, i);
+            }
+            BrMatrix34Copy(&car->car_master_actor->t.t.mat, &gLive_car_mats[cat][i]);
+            BrMatrix34TApplyV(&car->velocity_car_space, &car->v, &car->car_master_actor->t.t.mat);
+            BrVector3InvScale(&car->velocity_car_space, &car->velocity_car_space, WORLD_SCALE);
+            if (BrVector3LengthSquared(&car->velocity_car_space) >= .0001f) {
+                BrVector3Normalise(&car->direction, &car->v);
+            } else {
+                BrVector3Negate(&car->direction, (br_vector3*)car->car_master_actor->t.t.mat.m[2]);
+            }
+            BrVector3Copy(&car->pos, &car->car_master_actor->t.t.translate.t);
+            BrVector3InvScale(&com_offset_c, &car->cmpos, WORLD_SCALE);
+            BrMatrix34ApplyV(&com_offset_w, &com_offset_c, &car->car_master_actor->t.t.mat);
+            BrVector3Accumulate(&car->pos, &com_offset_w);
+        }
+    }
+}
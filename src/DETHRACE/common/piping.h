@@ -285,4 +285,12 @@ int GetNextIncident(tU32 pOffset_time, tIncident_type* pIncident_type, float* pS
 
 tU32 GetARStartTime(void);
 
+int ReadRecordedReplayHeader(char* pPath, tRecorded_replay_header* pHeader);
+
+int LoadRecordedReplay(char* pPath, tU32* pEnd_time);
+
+void SaveLiveCarMatrices(void);
+
+void RestoreLiveCarMatrices(void);
+
 #endif
@@ -325,6 +325,7 @@ void ToggleReplay(void) {
         gAction_replay_end_time = GetTotalTime();
         gLast_replay_frame_time = gAction_replay_end_time;
         gAction_replay_start_time = GetARStartTime();
+        SaveLiveCarMatrices(); // Added by dethrace
         ResetPipePlayToEnd();
         LoadInterfaceStuff(1);
         StartMouseCursor();
@@ -336,6 +337,7 @@ void ToggleReplay(void) {
         }
     } else {
         MoveToEndOfReplay();
+        RestoreLiveCarMatrices(); // Added by dethrace
         EndMouseCursor();
         S3SetEffects(NULL, NULL);
         UnlockInterfaceStuff();
@@ -346,11 +348,32 @@ void ToggleReplay(void) {
         if (gNet_mode == eNet_mode_host) {
             SendGameplayToAllPlayers(eNet_gameplay_host_unpaused, 0, 0, 0, 0);
         }
+        // Added by dethrace: there is no race to go back to behind a `--play-replay`
+        if (harness_game_config.play_replay_path[0] != '\0') {
+            gAbandon_game = 1;
+        }
     }
     gAction_replay_mode = !gAction_replay_mode;
     ForceRebuildActiveCarList();
 }
 
+// Added by dethrace: `--play-replay=<file>` turns the first frame of the race it was recorded in into the replay
+void PlayRecordedReplay(void) {
+    tU32 end_time;
+
+    if (!LoadRecordedReplay(harness_game_config.play_replay_path, &end_time)) {
+        LOG_WARN("Nothing to play in \"%s\"", harness_game_config.play_replay_path);
+        gAbandon_game = 1;
+        return;
+    }
+    ToggleReplay();
+    gAction_replay_end_time = end_time;
+    gLast_replay_frame_time = end_time;
+    gAction_replay_start_time = GetARStartTime();
+    MoveToStartOfReplay();
+    gPaused = 0;
+}
+
 // IDA: void __usercall ReverseSound(tS3_effect_tag pEffect_index@<EAX>, tS3_sound_tag pSound_tag@<EDX>)
 void ReverseSound(tS3_effect_tag pEffect_index, tS3_sound_tag pSound_tag) {
     LOG_TRACE("(%d, %d)", pEffect_index, pSound_tag);
@@ -378,6 +401,25 @@ int FindUniqueFile(void) {
     return 0;
 }
 
+// Added by dethrace: the first free REPLAYnnn.RPL for `--record-replays`, as FindUniqueFile does for BMPFILES.
+// Returns 0 when all of them are taken
+int FindUniqueReplayFile(char* pThe_path) {
+    int index;
+    FILE* f;
+    char name[16];
+
+    for (index = 0; index < 1000; index++) {
+        sprintf(name, "REPLAY%03d.RPL", index);
+        PathCat(pThe_path, gApplication_path, name);
+        f = DRfopen(pThe_path, "rb");
+        if (f == NULL) {
+            return 1;
+        }
+        fclose(f);
+    }
+    return 0;
+}
+
 // IDA: void __usercall PollActionReplayControls(tU32 pFrame_period@<EAX>)
 void PollActionReplayControls(tU32 pFrame_period) {
     float old_replay_rate;
@@ -50,10 +50,14 @@ void MoveToStartOfReplay(void);
 
 void ToggleReplay(void);
 
+void PlayRecordedReplay(void);
+
 void ReverseSound(tS3_effect_tag pEffect_index, tS3_sound_tag pSound_tag);
 
 int FindUniqueFile(void);
 
+int FindUniqueReplayFile(char* pThe_path);
+
 void PollActionReplayControls(tU32 pFrame_period);
 
 void CheckReplayTurnOn(void);
@@ -4,6 +4,7 @@
 #include <string.h>
 
 #include "brender.h"
+#include "car.h"
 #include "controls.h"
 #include "globvars.h"
 #include "graphics.h"
@@ -202,6 +203,7 @@ tS3_sound_tag DRS3StartSound(tS3_outlet_ptr pOutlet, tS3_sound_id pSound) {
     if (!gSound_enabled) {
         return 0;
     }
+    CarPhysicsSideEffect(0); // Added by dethrace
     if (pSound != 1000 && (pSound < 3000 || pSound > 3007) && (pSound < 5300 || pSound > 5320)) {
         PipeSingleSound(pOutlet, pSound, 0, 0, -1, 0);
     }
@@ -521,6 +523,7 @@ tS3_sound_tag DRS3StartSound3D(tS3_outlet_ptr pOutlet, tS3_sound_id pSound, br_v
     if (!gSound_enabled) {
         return 0;
     }
+    CarPhysicsSideEffect(0); // Added by dethrace
     if (pVolume && pSound != 1000 && (pSound < 3000 || pSound > 3007) && (pSound < 5300 || pSound > 5320)) {
         PipeSingleSound(pOutlet, pSound, pVolume, 0, pPitch, pInitial_position);
     }
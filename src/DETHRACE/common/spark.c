@@ -459,6 +459,7 @@ void CreateSparks(br_vector3* pos, br_vector3* v, br_vector3* pForce, br_scalar
     int i;
     LOG_TRACE("(%p, %p, %p, %f, %p)", pos, v, pForce, sparkiness, pCar);
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     ts = BrVector3Length(pForce);
     BrVector3InvScale(&normal, pForce, ts);
     ts2 = BrVector3Dot(pForce, v);
@@ -2200,6 +2201,7 @@ void StopCarSmoking(tCar_spec* pCar) {
     int i;
     LOG_TRACE("(%p)", pCar);
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     for (i = 0; i < MAX_SMOKE_COLUMNS; i++) {
         if (gSmoke_column[i].car == pCar && gSmoke_column[i].lifetime > 2000) {
             gSmoke_column[i].lifetime = 2000;
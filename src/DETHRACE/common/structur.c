@@ -11,7 +11,9 @@
 #include "globvrkm.h"
 #include "globvrpb.h"
 #include "graphics.h"
+#include "harness/benchmark.h"
 #include "harness/config.h"
+#include "harness/os.h"
 #include "harness/trace.h"
 #include "init.h"
 #include "loading.h"
@@ -19,6 +21,7 @@
 #include "mainloop.h"
 #include "mainmenu.h"
 #include "netgame.h"
+#include "newgame.h"
 #include "network.h"
 #include "opponent.h"
 #include "piping.h"
@@ -28,7 +31,9 @@
 #include "sound.h"
 #include "utility.h"
 #include "world.h"
+#include <ctype.h>
 #include <stdlib.h>
+#include <string.h>
 
 int gLast_wrong_checkpoint;
 int gMirror_on__structur = 1; // suffix added to avoid duplicate symbol
@@ -634,6 +639,121 @@ void DoGame(void) {
     }
 }
 
+// Added by dethrace: load the race and grid without any interface screens. `pRecorded` gives the opponents a replay
+// was recorded against, NULL picks them as a new race would
+static void LoadRaceWithoutInterface(int pRace_index, char* pCar_name, int pCar_index, tRecorded_replay_header* pRecorded) {
+    int i;
+
+    gNet_mode = eNet_mode_none;
+    gProgram_state.frank_or_anniness = eFrankie;
+    gProgram_state.skill_level = 1;
+    AboutToLoadFirstCar();
+    SwitchToRealResolution();
+    LoadCar(
+        pCar_name,
+        eDriver_local_human,
+        &gProgram_state.current_car,
+        pCar_index,
+        gProgram_state.player_name[gProgram_state.frank_or_anniness],
+        &gOur_car_storage_space);
+    SwitchToLoresMode();
+    SetCarStorageTexturingLevel(&gOur_car_storage_space, GetCarTexturingLevel(), eCTL_full);
+    InitGame(pRace_index);
+
+    gAbandon_game = 0;
+    gCar_to_view = &gProgram_state.current_car;
+    gProgram_state.prog_status = eProg_game_ongoing;
+    if (pRecorded != NULL) {
+        // the grid as it was raced, our own car included, so SortOpponents leaves it alone
+        gCurrent_race.number_of_racers = pRecorded->number_of_racers;
+        for (i = 0; i < pRecorded->number_of_racers; i++) {
+            gCurrent_race.opponent_list[i].index = pRecorded->opponent_indices[i];
+            gCurrent_race.opponent_list[i].ranking = gProgram_state.rank;
+            if (pRecorded->opponent_indices[i] < 0) {
+                gCurrent_race.opponent_list[i].car_spec = &gProgram_state.current_car;
+                gOur_starting_position = i;
+            }
+        }
+    } else {
+        SelectOpponents(&gCurrent_race);
+    }
+    LoadRaceInfo(gProgram_state.current_race_index, &gCurrent_race);
+    FillInRaceInfo(&gCurrent_race);
+    DisposeRaceInfo(&gCurrent_race);
+    LoadOpponentsCars(&gCurrent_race);
+    InitRace();
+    SortOpponents();
+    SetInitialPositions(&gCurrent_race);
+    SwitchToRealResolution();
+    InitOpponents(&gCurrent_race);
+    InitialiseCarsEtc(&gCurrent_race);
+    SetInitialCopPositions();
+    InitSoundSources();
+    InitLastDamageArrayEtc();
+}
+
+// Added by dethrace
+static void DisposeRaceWithoutInterface(void) {
+    SwitchToLoresMode();
+    DisposeRace();
+    DisposeOpponentsCars(&gCurrent_race);
+    DisposeTrack();
+}
+
+// Added by dethrace
+// Headless `--benchmark=<race>,<seconds>`: load the race and grid without any interface screens, then race
+// with a scripted player car on the virtual benchmark clock until the requested time has elapsed
+void DoBenchmarkRace(void) {
+    int i;
+    int race_index;
+    char* race;
+
+    race = harness_game_config.benchmark_race;
+    race_index = -1;
+    if (isdigit((unsigned char)race[0])) {
+        race_index = atoi(race);
+    } else {
+        for (i = 0; i < gNumber_of_races; i++) {
+            if (strcasecmp(gRace_list[i].name, race) == 0) {
+                race_index = i;
+                break;
+            }
+        }
+    }
+    if (race_index < 0 || race_index >= gNumber_of_races) {
+        LOG_PANIC("Unknown benchmark race \"%s\"", race);
+    }
+    // same seed every run so opponents, peds and sparks behave identically
+    srand(race_index);
+
+    LoadRaceWithoutInterface(race_index, gBasic_car_names[eFrankie], eFrankie, NULL);
+    DoRace();
+    LOG_INFO("Benchmark finished, car at %f, %f, %f",
+        gProgram_state.current_car.car_master_actor->t.t.translate.t.v[0],
+        gProgram_state.current_car.car_master_actor->t.t.translate.t.v[1],
+        gProgram_state.current_car.car_master_actor->t.t.translate.t.v[2]);
+    DisposeRaceWithoutInterface();
+    Harness_Benchmark_Report();
+}
+
+// Added by dethrace
+// `--play-replay=<file>`: load the race, car and opponents a `--record-replays` file was recorded with, without any
+// interface screens. The race loop then hands its first frame over to the action replay of the file
+void DoRecordedReplay(void) {
+    tRecorded_replay_header header;
+
+    if (!ReadRecordedReplayHeader(harness_game_config.play_replay_path, &header)) {
+        return;
+    }
+    if (header.race_index < 0 || header.race_index >= gNumber_of_races) {
+        LOG_WARN("\"%s\" was recorded on race %d, which is not installed", harness_game_config.play_replay_path, header.race_index);
+        return;
+    }
+    LoadRaceWithoutInterface(header.race_index, header.car_name, header.car_index, &header);
+    DoRace();
+    DisposeRaceWithoutInterface();
+}
+
 // IDA: void __cdecl InitialiseProgramState()
 void InitialiseProgramState(void) {
     gProgram_state.loaded = 0;
@@ -47,6 +47,10 @@ void SwapNetCarsDispose(void);
 
 void DoGame(void);
 
+void DoBenchmarkRace(void);
+
+void DoRecordedReplay(void);
+
 void InitialiseProgramState(void);
 
 void DoProgram(void);
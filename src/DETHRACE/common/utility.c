@@ -2,6 +2,7 @@
 #include <stdlib.h>
 
 #include "brender.h"
+#include "car.h"
 #include "constants.h"
 #include "errors.h"
 #include "globvars.h"
@@ -21,6 +22,7 @@
 #include "world.h"
 
 #include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -207,6 +209,7 @@ int IRandomBetween(int pA, int pB) {
     int num;
     char s[32];
 
+    CarPhysicsSideEffect(0); // Added by dethrace
     num = rand();
 #if RAND_MAX == 0x7fff
     //  If RAND_MAX == 0x7fff, then `num` can be seen as a fixed point number with 15 fractional and 17 integral bits
@@ -234,6 +237,7 @@ int IRandomPosNeg(int pN) {
 // IDA: float __cdecl FRandomBetween(float pA, float pB)
 float FRandomBetween(float pA, float pB) {
     LOG_TRACE8("(%f, %f)", pA, pB);
+    CarPhysicsSideEffect(0); // Added by dethrace
     return (double)rand() * (pB - pA) / (double)RAND_MAX + pA;
 }
 
@@ -849,6 +853,147 @@ int FindBestMatch(tRGB_colour* pRGB_colour, br_pixelmap* pPalette) {
     return near_c;
 }
 
+// Added by dethrace
+// FindBestMatch against a 32x32x32 grid of 8x8x8 colour cells. Each cell keeps, in palette order, every entry that could
+// be nearest to some colour inside it: those no further from the cell than the entry whose furthest corner is closest.
+// Scanning just those with FindBestMatch's strict compare gives the same answer, ties and all
+#define PALETTE_MATCH_CELL_SHIFT 3
+#define PALETTE_MATCH_CELLS_PER_AXIS (256 >> PALETTE_MATCH_CELL_SHIFT)
+
+typedef struct tPalette_match_cell {
+    int first; // into gPalette_match.candidates, -1 until the cell is first needed
+    int count;
+} tPalette_match_cell;
+
+typedef struct tPalette_match {
+    br_colour colours[256];
+    tPalette_match_cell* cells;
+    tU8* candidates;
+    int candidates_used;
+    int candidates_size;
+} tPalette_match;
+
+static tPalette_match gPalette_match;
+
+// Added by dethrace
+void PreparePaletteMatch(br_pixelmap* pPalette) {
+    int i;
+
+    if (gPalette_match.cells == NULL) {
+        gPalette_match.cells = BrMemAllocate(PALETTE_MATCH_CELLS_PER_AXIS * PALETTE_MATCH_CELLS_PER_AXIS * PALETTE_MATCH_CELLS_PER_AXIS * sizeof(tPalette_match_cell), kMem_palette_match);
+    } else if (memcmp(gPalette_match.colours, pPalette->pixels, sizeof(gPalette_match.colours)) == 0) {
+        return;
+    }
+    memcpy(gPalette_match.colours, pPalette->pixels, sizeof(gPalette_match.colours));
+    for (i = 0; i < PALETTE_MATCH_CELLS_PER_AXIS * PALETTE_MATCH_CELLS_PER_AXIS * PALETTE_MATCH_CELLS_PER_AXIS; i++) {
+        gPalette_match.cells[i].first = -1;
+    }
+    gPalette_match.candidates_used = 0;
+}
+
+// Added by dethrace
+static void PaletteMatchAxis(int pValue, int pLow, int pHigh, int* pNear, int* pFar) {
+
+    if (pValue < pLow) {
+        *pNear = pLow - pValue;
+        *pFar = pHigh - pValue;
+    } else if (pValue > pHigh) {
+        *pNear = pValue - pHigh;
+        *pFar = pValue - pLow;
+    } else {
+        *pNear = 0;
+        *pFar = MAX(pValue - pLow, pHigh - pValue);
+    }
+}
+
+// Added by dethrace
+static void BuildPaletteMatchCell(tPalette_match_cell* pCell, int pRed_cell, int pGreen_cell, int pBlue_cell) {
+    int nearest[256];
+    int furthest;
+    int near_d;
+    int far_d;
+    int n;
+    int low[3];
+    int near_axis[3];
+    int far_axis[3];
+    tU8* bigger;
+
+    low[0] = pRed_cell << PALETTE_MATCH_CELL_SHIFT;
+    low[1] = pGreen_cell << PALETTE_MATCH_CELL_SHIFT;
+    low[2] = pBlue_cell << PALETTE_MATCH_CELL_SHIFT;
+    furthest = INT_MAX;
+    for (n = 0; n < 256; n++) {
+        PaletteMatchAxis((gPalette_match.colours[n] >> 16) & 0xff, low[0], low[0] + (1 << PALETTE_MATCH_CELL_SHIFT) - 1, &near_axis[0], &far_axis[0]);
+        PaletteMatchAxis((gPalette_match.colours[n] >> 8) & 0xff, low[1], low[1] + (1 << PALETTE_MATCH_CELL_SHIFT) - 1, &near_axis[1], &far_axis[1]);
+        PaletteMatchAxis((gPalette_match.colours[n] >> 0) & 0xff, low[2], low[2] + (1 << PALETTE_MATCH_CELL_SHIFT) - 1, &near_axis[2], &far_axis[2]);
+        near_d = near_axis[0] * near_axis[0] + near_axis[1] * near_axis[1] + near_axis[2] * near_axis[2];
+        far_d = far_axis[0] * far_axis[0] + far_axis[1] * far_axis[1] + far_axis[2] * far_axis[2];
+        nearest[n] = near_d;
+        furthest = MIN(furthest, far_d);
+    }
+    if (gPalette_match.candidates_size - gPalette_match.candidates_used < 256) {
+        bigger = BrMemAllocate(gPalette_match.candidates_size * 2 + 4096, kMem_palette_match);
+        if (gPalette_match.candidates != NULL) {
+            memcpy(bigger, gPalette_match.candidates, gPalette_match.candidates_used);
+            BrMemFree(gPalette_match.candidates);
+        }
+        gPalette_match.candidates = bigger;
+        gPalette_match.candidates_size = gPalette_match.candidates_size * 2 + 4096;
+    }
+    pCell->first = gPalette_match.candidates_used;
+    pCell->count = 0;
+    for (n = 0; n < 256; n++) {
+        if (nearest[n] <= furthest) {
+            gPalette_match.candidates[pCell->first + pCell->count] = n;
+            pCell->count++;
+        }
+    }
+    gPalette_match.candidates_used += pCell->count;
+}
+
+// Added by dethrace: FindBestMatch for the palette last given to PreparePaletteMatch
+int FindBestMatchInCells(tRGB_colour* pRGB_colour, br_pixelmap* pPalette) {
+    tPalette_match_cell* cell;
+    tRGB_colour trial_RGB;
+    tU8* candidate;
+    int red_cell;
+    int green_cell;
+    int blue_cell;
+    int near_c;
+    int min_d;
+    int d;
+    int n;
+
+    if (pRGB_colour->red < 0 || pRGB_colour->red > 255
+        || pRGB_colour->green < 0 || pRGB_colour->green > 255
+        || pRGB_colour->blue < 0 || pRGB_colour->blue > 255) {
+        return FindBestMatch(pRGB_colour, pPalette);
+    }
+    red_cell = pRGB_colour->red >> PALETTE_MATCH_CELL_SHIFT;
+    green_cell = pRGB_colour->green >> PALETTE_MATCH_CELL_SHIFT;
+    blue_cell = pRGB_colour->blue >> PALETTE_MATCH_CELL_SHIFT;
+    cell = &gPalette_match.cells[(red_cell * PALETTE_MATCH_CELLS_PER_AXIS + green_cell) * PALETTE_MATCH_CELLS_PER_AXIS + blue_cell];
+    if (cell->first < 0) {
+        BuildPaletteMatchCell(cell, red_cell, green_cell, blue_cell);
+    }
+    near_c = 127;
+    min_d = INT_MAX;
+    candidate = &gPalette_match.candidates[cell->first];
+    for (n = 0; n < cell->count; n++) {
+        trial_RGB.red = (gPalette_match.colours[candidate[n]] >> 16) & 0xff;
+        trial_RGB.green = (gPalette_match.colours[candidate[n]] >> 8) & 0xff;
+        trial_RGB.blue = (gPalette_match.colours[candidate[n]] >> 0) & 0xff;
+        d = (pRGB_colour->red - trial_RGB.red) * (pRGB_colour->red - trial_RGB.red)
+            + (pRGB_colour->green - trial_RGB.green) * (pRGB_colour->green - trial_RGB.green)
+            + (pRGB_colour->blue - trial_RGB.blue) * (pRGB_colour->blue - trial_RGB.blue);
+        if (d < min_d) {
+            min_d = d;
+            near_c = candidate[n];
+        }
+    }
+    return near_c;
+}
+
 // IDA: void __usercall BuildShadeTablePath(char *pThe_path@<EAX>, int pR@<EDX>, int pG@<EBX>, int pB@<ECX>)
 void BuildShadeTablePath(char* pThe_path, int pR, int pG, int pB) {
     char s[32];
@@ -886,6 +1031,133 @@ void SaveGeneratedShadeTable(br_pixelmap* pThe_table, int pR, int pG, int pB) {
     BrPixelmapSave(the_path, pThe_table);
 }
 
+// Added by dethrace
+// Derived assets are things the game works out from its data and could save itself working out again next time.
+// Each is saved under a key hashed from everything it was made from, so a file is only ever found again by the exact
+// same inputs. The header carries a version, bumped whenever a generator's output changes, and the key again
+#define DERIVED_ASSET_MAGIC 0x41565244 // "DRVA"
+#define DERIVED_ASSET_VERSION 1
+#define DERIVED_ASSET_HASH_SEED 0x811c9dc5
+
+// Added by dethrace: FNV-1a, feed it every input in turn starting from DERIVED_ASSET_HASH_SEED
+tU32 HashDerivedAssetInput(tU32 pHash, void* pData, int pSize) {
+    tU8* p;
+    int i;
+
+    p = pData;
+    for (i = 0; i < pSize; i++) {
+        pHash = (pHash ^ p[i]) * 0x01000193;
+    }
+    return pHash;
+}
+
+// Added by dethrace: <prefix><key as 8 letters>.DRV in the SHADETAB directory, next to the original generated tables
+void BuildDerivedAssetPath(char* pThe_path, char* pPrefix, tU32 pKey) {
+    char s[32];
+    int i;
+
+    strcpy(s, pPrefix);
+    for (i = 0; i < 8; i++) {
+        s[strlen(pPrefix) + i] = 'A' + ((pKey >> (28 - 4 * i)) & 0xf);
+    }
+    s[strlen(pPrefix) + 8] = '\0';
+    strcat(s, ".DRV");
+    PathCat(pThe_path, gApplication_path, "SHADETAB");
+    PathCat(pThe_path, pThe_path, s);
+}
+
+// Added by dethrace: writes go to a temporary file which only replaces pThe_path once it is complete,
+// so a crash or a full disk part way through never leaves a truncated asset behind
+FILE* OpenDerivedAssetForWriting(char* pThe_path, char* pTemp_path) {
+    FILE* f;
+
+    sprintf(pTemp_path, "%s.TMP", pThe_path);
+    f = fopen(pTemp_path, "wb");
+    if (f == NULL) {
+        dr_dprintf("Could not write \"%s\"", pTemp_path);
+    }
+    return f;
+}
+
+// Added by dethrace
+void CommitDerivedAsset(FILE* pF, char* pThe_path, char* pTemp_path) {
+    int failed;
+
+    failed = ferror(pF);
+    failed |= fclose(pF);
+    if (failed) {
+        dr_dprintf("Could not write \"%s\"", pTemp_path);
+        remove(pTemp_path);
+        return;
+    }
+#ifdef _WIN32
+    // rename will not replace an existing file here, so there is a moment with neither
+    remove(pThe_path);
+#endif
+    if (rename(pTemp_path, pThe_path) != 0) {
+        dr_dprintf("Could not rename \"%s\" to \"%s\"", pTemp_path, pThe_path);
+        remove(pTemp_path);
+        return;
+    }
+    Harness_Hook_FileReplaced(pThe_path);
+}
+
+// Added by dethrace: returns 0, leaving pData in an unknown state, if the file is missing, stale or not pSize long
+int LoadDerivedAsset(char* pThe_path, tU32 pKey, void* pData, int pSize) {
+    FILE* f;
+    int loaded;
+    int old_allow_open_to_fail;
+
+    old_allow_open_to_fail = gAllow_open_to_fail;
+    AllowOpenToFail();
+    f = DRfopen(pThe_path, "rb");
+    gAllow_open_to_fail = old_allow_open_to_fail;
+    if (f == NULL) {
+        return 0;
+    }
+    loaded = ReadU32(f) == DERIVED_ASSET_MAGIC
+        && ReadU32(f) == DERIVED_ASSET_VERSION
+        && ReadU32(f) == pKey
+        && ReadU32(f) == (tU32)pSize
+        && fread(pData, 1, pSize, f) == (size_t)pSize;
+    fclose(f);
+    return loaded;
+}
+
+// Added by dethrace
+void SaveDerivedAsset(char* pThe_path, tU32 pKey, void* pData, int pSize) {
+    char temp_path[256];
+    FILE* f;
+
+    f = OpenDerivedAssetForWriting(pThe_path, temp_path);
+    if (f == NULL) {
+        return;
+    }
+    WriteU32L(f, DERIVED_ASSET_MAGIC);
+    WriteU32L(f, DERIVED_ASSET_VERSION);
+    WriteU32L(f, pKey);
+    WriteU32L(f, pSize);
+    fwrite(pData, 1, pSize, f);
+    CommitDerivedAsset(f, pThe_path, temp_path);
+}
+
+// Added by dethrace: everything GenerateDarkenedShadeTable's output depends on. The original cache goes only by the mix
+static tU32 ShadeTableKey(int pHeight, br_pixelmap* pPalette, int pRed_mix, int pGreen_mix, int pBlue_mix, float pQuarter, float pHalf, float pThree_quarter, br_scalar pDarken) {
+    tU32 key;
+
+    key = HashDerivedAssetInput(DERIVED_ASSET_HASH_SEED, "shade table", 11);
+    key = HashDerivedAssetInput(key, pPalette->pixels, 256 * sizeof(br_colour));
+    key = HashDerivedAssetInput(key, &pHeight, sizeof(pHeight));
+    key = HashDerivedAssetInput(key, &pRed_mix, sizeof(pRed_mix));
+    key = HashDerivedAssetInput(key, &pGreen_mix, sizeof(pGreen_mix));
+    key = HashDerivedAssetInput(key, &pBlue_mix, sizeof(pBlue_mix));
+    key = HashDerivedAssetInput(key, &pQuarter, sizeof(pQuarter));
+    key = HashDerivedAssetInput(key, &pHalf, sizeof(pHalf));
+    key = HashDerivedAssetInput(key, &pThree_quarter, sizeof(pThree_quarter));
+    key = HashDerivedAssetInput(key, &pDarken, sizeof(pDarken));
+    return key;
+}
+
 // IDA: br_pixelmap* __usercall GenerateShadeTable@<EAX>(int pHeight@<EAX>, br_pixelmap *pPalette@<EDX>, int pRed_mix@<EBX>, int pGreen_mix@<ECX>, int pBlue_mix, float pQuarter, float pHalf, float pThree_quarter)
 br_pixelmap* GenerateShadeTable(int pHeight, br_pixelmap* pPalette, int pRed_mix, int pGreen_mix, int pBlue_mix, float pQuarter, float pHalf, float pThree_quarter) {
     LOG_TRACE("(%d, %p, %d, %d, %d, %f, %f, %f)", pHeight, pPalette, pRed_mix, pGreen_mix, pBlue_mix, pQuarter, pHalf, pThree_quarter);
@@ -918,8 +1190,24 @@ br_pixelmap* GenerateDarkenedShadeTable(int pHeight, br_pixelmap* pPalette, int
     double ratio2;
     int i;
     int c;
+    char derived_path[256];
+    tU32 key;
     LOG_TRACE("(%d, %p, %d, %d, %d, %f, %f, %f, %f)", pHeight, pPalette, pRed_mix, pGreen_mix, pBlue_mix, pQuarter, pHalf, pThree_quarter, pDarken);
 
+    // Added by dethrace: one we generated before from exactly these inputs comes first, so an original table that
+    // only shares the mix cannot stand in for it
+    key = ShadeTableKey(pHeight, pPalette, pRed_mix, pGreen_mix, pBlue_mix, pQuarter, pHalf, pThree_quarter, pDarken);
+    BuildDerivedAssetPath(derived_path, "st", key);
+    the_table = BrPixelmapAllocate(BR_PMT_INDEX_8, 256, pHeight, NULL, 0);
+    if (the_table == NULL) {
+        FatalError(kFatalError_LoadGeneratedShadeTable);
+    }
+    if (the_table->row_bytes == 256 && LoadDerivedAsset(derived_path, key, the_table->pixels, 256 * pHeight)) {
+        BrTableAdd(the_table);
+        return the_table;
+    }
+    BrPixelmapFree(the_table);
+
     the_table = LoadGeneratedShadeTable(pRed_mix, pGreen_mix, pBlue_mix);
     if (the_table == NULL) {
         the_table = BrPixelmapAllocate(BR_PMT_INDEX_8, 256, pHeight, NULL, 0);
@@ -927,6 +1215,8 @@ br_pixelmap* GenerateDarkenedShadeTable(int pHeight, br_pixelmap* pPalette, int
             FatalError(kFatalError_LoadGeneratedShadeTable);
         }
         cp = pPalette->pixels;
+        // Added by dethrace
+        PreparePaletteMatch(pPalette);
 
         ref_col.red = pRed_mix;
         ref_col.green = pGreen_mix;
@@ -962,10 +1252,15 @@ br_pixelmap* GenerateDarkenedShadeTable(int pHeight, br_pixelmap* pPalette, int
                 new_RGB.red = ref_col.red * ratio2 + the_RGB.red * (1. - ratio2);
                 new_RGB.green = ref_col.green * ratio2 + the_RGB.green * (1. - ratio2);
                 new_RGB.blue = ref_col.blue * ratio2 + the_RGB.blue * (1. - ratio2);
-                *shade_ptr = FindBestMatch(&new_RGB, pPalette);
+                // Added by dethrace: was FindBestMatch(&new_RGB, pPalette)
+                *shade_ptr = FindBestMatchInCells(&new_RGB, pPalette);
             }
         }
-        SaveGeneratedShadeTable(the_table, pRed_mix, pGreen_mix, pBlue_mix);
+        // Added by dethrace: was SaveGeneratedShadeTable(the_table, pRed_mix, pGreen_mix, pBlue_mix), which a different
+        // table with the same mix would then have loaded in place of its own
+        if (the_table->row_bytes == 256) {
+            SaveDerivedAsset(derived_path, key, the_table->pixels, 256 * pHeight);
+        }
     }
     BrTableAdd(the_table);
     return the_table;
@@ -1366,6 +1661,8 @@ void EncodeFile(char* pThe_path) {
     PDFileUnlock(pThe_path);
     remove(pThe_path);
     rename(new_file, pThe_path);
+    // Added by dethrace: a packed copy of the file would still be the unencoded one
+    Harness_Hook_FileReplaced(pThe_path);
 }
 
 // IDA: void __usercall EncodeFileWrapper(char *pThe_path@<EAX>)
@@ -112,12 +112,30 @@ double RGBDifferenceSqr(tRGB_colour* pColour_1, tRGB_colour* pColour_2);
 
 int FindBestMatch(tRGB_colour* pRGB_colour, br_pixelmap* pPalette);
 
+// Added by dethrace
+void PreparePaletteMatch(br_pixelmap* pPalette);
+
+// Added by dethrace
+int FindBestMatchInCells(tRGB_colour* pRGB_colour, br_pixelmap* pPalette);
+
 void BuildShadeTablePath(char* pThe_path, int pR, int pG, int pB);
 
 br_pixelmap* LoadGeneratedShadeTable(int pR, int pG, int pB);
 
 void SaveGeneratedShadeTable(br_pixelmap* pThe_table, int pR, int pG, int pB);
 
+tU32 HashDerivedAssetInput(tU32 pHash, void* pData, int pSize);
+
+void BuildDerivedAssetPath(char* pThe_path, char* pPrefix, tU32 pKey);
+
+FILE* OpenDerivedAssetForWriting(char* pThe_path, char* pTemp_path);
+
+void CommitDerivedAsset(FILE* pF, char* pThe_path, char* pTemp_path);
+
+int LoadDerivedAsset(char* pThe_path, tU32 pKey, void* pData, int pSize);
+
+void SaveDerivedAsset(char* pThe_path, tU32 pKey, void* pData, int pSize);
+
 br_pixelmap* GenerateShadeTable(int pHeight, br_pixelmap* pPalette, int pRed_mix, int pGreen_mix, int pBlue_mix, float pQuarter, float pHalf, float pThree_quarter);
 
 br_pixelmap* GenerateDarkenedShadeTable(int pHeight, br_pixelmap* pPalette, int pRed_mix, int pGreen_mix, int pBlue_mix, float pQuarter, float pHalf, float pThree_quarter, br_scalar pDarken);
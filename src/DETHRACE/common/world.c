@@ -14,6 +14,7 @@
 #include "globvars.h"
 #include "globvrpb.h"
 #include "graphics.h"
+#include "harness/prefetch.h"
 #include "harness/trace.h"
 #include "input.h"
 #include "loading.h"
@@ -745,6 +746,43 @@ int LoadNTrackModels(tBrender_storage* pStorage_space, FILE* pF, int pCount) {
     return new_ones;
 }
 
+// Added by dethrace: start reading the files named by the next `pCount` lines of `pF` on a background thread, so that
+// each one is already in memory by the time the LoadN* function after this gets to it. `pF` is left where it was
+static void PrefetchListedFiles(FILE* pF, int pCount, char* pRes_dir, char* pSub_dir) {
+    tPath_name* paths;
+    const char** path_list;
+    long start;
+    int i;
+    char s[256];
+    char* str;
+    char* saveptr;
+
+    if (pCount <= 0) {
+        return;
+    }
+    start = ftell(pF);
+    if (start < 0) {
+        return;
+    }
+    path_list = BrMemAllocate(pCount * (sizeof(char*) + sizeof(tPath_name)), kMem_misc);
+    paths = (tPath_name*)(path_list + pCount);
+    for (i = 0; i < pCount; i++) {
+        GetALineWithNoPossibleService(pF, (unsigned char*)s);
+        str = strtok_r(s, "\t ,/", &saveptr);
+        if (pRes_dir != NULL) {
+            PathCat(paths[i], gApplication_path, pRes_dir);
+            PathCat(paths[i], paths[i], pSub_dir);
+        } else {
+            PathCat(paths[i], gApplication_path, pSub_dir);
+        }
+        PathCat(paths[i], paths[i], str != NULL ? str : "");
+        path_list[i] = paths[i];
+    }
+    fseek(pF, start, SEEK_SET);
+    Harness_Prefetch_Files(path_list, pCount);
+    BrMemFree(path_list);
+}
+
 // IDA: void __usercall LoadSomePixelmaps(tBrender_storage *pStorage_space@<EAX>, FILE *pF@<EDX>)
 void LoadSomePixelmaps(tBrender_storage* pStorage_space, FILE* pF) {
     tPath_name the_path;
@@ -760,7 +798,9 @@ void LoadSomePixelmaps(tBrender_storage* pStorage_space, FILE* pF) {
     GetALineAndDontArgue(pF, s);
     str = strtok_r(s, "\t ,/", &saveptr);
     sscanf(str, "%d", &count);
+    PrefetchListedFiles(pF, count, gGraf_specs[gGraf_spec_index].data_dir_name, "PIXELMAP");
     LoadNPixelmaps(pStorage_space, pF, count);
+    Harness_Prefetch_Release();
 }
 
 // IDA: void __usercall LoadSomeShadeTables(tBrender_storage *pStorage_space@<EAX>, FILE *pF@<EDX>)
@@ -778,7 +818,9 @@ void LoadSomeShadeTables(tBrender_storage* pStorage_space, FILE* pF) {
     GetALineAndDontArgue(pF, s);
     str = strtok_r(s, "\t ,/", &saveptr);
     sscanf(str, "%d", &count);
+    PrefetchListedFiles(pF, count, NULL, "SHADETAB");
     LoadNShadeTables(pStorage_space, pF, count);
+    Harness_Prefetch_Release();
 }
 
 // IDA: void __usercall LoadSomeMaterials(tBrender_storage *pStorage_space@<EAX>, FILE *pF@<EDX>)
@@ -796,7 +838,9 @@ void LoadSomeMaterials(tBrender_storage* pStorage_space, FILE* pF) {
     GetALineAndDontArgue(pF, s);
     str = strtok_r(s, "\t ,/", &saveptr);
     sscanf(str, "%d", &count);
+    PrefetchListedFiles(pF, count, NULL, "MATERIAL");
     LoadNMaterials(pStorage_space, pF, count);
+    Harness_Prefetch_Release();
 }
 
 // IDA: void __usercall LoadSomeModels(tBrender_storage *pStorage_space@<EAX>, FILE *pF@<EDX>)
@@ -814,7 +858,9 @@ void LoadSomeModels(tBrender_storage* pStorage_space, FILE* pF) {
     GetALineAndDontArgue(pF, s);
     str = strtok_r(s, "\t ,/", &saveptr);
     sscanf(str, "%d", &count);
+    PrefetchListedFiles(pF, count, NULL, "MODELS");
     LoadNModels(pStorage_space, pF, count);
+    Harness_Prefetch_Release();
 }
 
 // IDA: void __usercall LoadSomeTrackModels(tBrender_storage *pStorage_space@<EAX>, FILE *pF@<EDX>)
@@ -832,7 +878,9 @@ void LoadSomeTrackModels(tBrender_storage* pStorage_space, FILE* pF) {
     GetALineAndDontArgue(pF, s);
     str = strtok_r(s, "\t ,/", &saveptr);
     sscanf(str, "%d", &count);
+    PrefetchListedFiles(pF, count, NULL, "MODELS");
     LoadNTrackModels(pStorage_space, pF, count);
+    Harness_Prefetch_Release();
 }
 
 // IDA: void __usercall AddFunkGrooveBinding(int pSlot_number@<EAX>, float *pPeriod_address@<EDX>)
@@ -2166,6 +2214,8 @@ void ReallySetRoadTexturingLevel(tRoad_texturing_level pLevel) {
 
     if (pLevel != gRoad_texturing_level) {
         ProcessFaceMaterials(gProgram_state.track_spec.the_actor, (pLevel == eRTL_none) ? RoadUntexToPersp : RoadPerspToUntex);
+        // Added by dethrace: ProcessModelFaceMaterials has prepared the track's models again
+        RefreshFaceGrid(&gProgram_state.track_spec);
     }
 }
 
@@ -2206,6 +2256,8 @@ void ReallySetWallTexturingLevel(tWall_texturing_level pLevel) {
 
     if (gWall_texturing_level != pLevel) {
         ProcessFaceMaterials(gProgram_state.track_spec.the_actor, tweaker[gWall_texturing_level][pLevel]);
+        // Added by dethrace: ProcessModelFaceMaterials has prepared the track's models again
+        RefreshFaceGrid(&gProgram_state.track_spec);
     }
 }
 
@@ -2591,6 +2643,8 @@ void LoadTrack(char* pFile_name, tTrack_spec* pTrack_spec, tRace_info* pRace_inf
             DodgyModelUpdate(gTrack_storage_space.models[i]);
         }
     }
+    // Added by dethrace
+    LoadColumnVisibility(pTrack_spec, the_path);
     PrintMemoryDump(0, "JUST LOADED IN TRACK ACTOR AND PROCESSED COLUMNS");
     gTrack_actor = pTrack_spec->the_actor;
     if (!gRendering_accessories && !gNet_mode) {
@@ -4132,6 +4186,7 @@ void StopGroovidelic(br_actor* pActor) {
     tGroovidelic_spec* the_groove;
     LOG_TRACE("(%p)", pActor);
 
+    CarPhysicsSideEffect(1); // Added by dethrace
     for (i = 0; i < gGroovidelics_array_size; i++) {
         the_groove = &gGroovidelics_array[i];
         if (the_groove->actor == pActor) {
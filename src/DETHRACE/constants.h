@@ -140,7 +140,15 @@ typedef enum dr_memory_classes {
     kMem_DOS_HMI_file_open = 242,                                        //  0xf2
     kMem_abuse_text = 243,                                               //  0xf3
     kMem_action_replay_buffer = 244,                                     //  0xf4
-    kMem_misc = 245                                                      //  0xf5
+    kMem_misc = 245,                                                     //  0xf5
+    kMem_face_grid = 246,                                                //  0xf6, added by dethrace
+    kMem_face_cache = 247,                                               //  0xf7, added by dethrace
+    kMem_car_jobs = 248,                                                 //  0xf8, added by dethrace
+    kMem_oppo_path_index = 249,                                          //  0xf9, added by dethrace
+    kMem_visible_columns = 250,                                          //  0xfa, added by dethrace
+    kMem_column_visibility = 251,                                        //  0xfb, added by dethrace
+    kMem_palette_match = 252,                                            //  0xfc, added by dethrace
+    kMem_pipe_frame_index = 253                                          //  0xfd, added by dethrace
 } dr_memory_classes;
 
 typedef enum keycodes {
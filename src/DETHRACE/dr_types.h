@@ -407,6 +407,45 @@ typedef struct exception_ {
     double retval;
 } exception_;
 
+// Added by dethrace: static track faces flattened per column by BuildFaceGrid, so box queries are a linear scan
+typedef struct tFace_grid_face {
+    br_bounds bounds;
+    br_vector4 eqn;
+    br_vector3 v[3];
+} tFace_grid_face;
+
+typedef struct tFace_grid_face_info {
+    struct v11group* group; // NULL when `actor` is moveable and has to be walked with ActorBoxPick
+    br_actor* actor;
+    br_model* model;
+    br_material* material;
+    br_uint_16 vertex_numbers[3];
+    br_uint_16 flags;
+} tFace_grid_face_info;
+
+typedef struct tFace_grid_cell {
+    int first;
+    int count;
+    int has_actors;
+    br_bounds bounds; // of the static faces only
+} tFace_grid_cell;
+
+typedef struct tFace_grid {
+    tFace_grid_cell* cells; // [z * ncolumns_x + x]
+    tFace_grid_face* faces;
+    tFace_grid_face_info* info;
+    int nfaces;
+    int nfaces_allocated;
+} tFace_grid;
+
+// Added by dethrace: columns that can be seen from each column, baked with `--bake-pvs` into a .PVS file beside the track actor
+typedef struct tColumn_visibility {
+    tU8* bits;              // one row per viewing column [z * ncolumns_x + x], one bit per column it can see. NULL without a .PVS
+    br_scalar* eye_heights; // lowest and highest camera y each row holds for
+    int row_bytes;
+    br_scalar range; // nothing further than this from the viewing column was baked
+} tColumn_visibility;
+
 typedef struct tTrack_spec {
     tU8 ncolumns_x;
     tU8 ncolumns_z;
@@ -420,6 +459,8 @@ typedef struct tTrack_spec {
     br_actor*** blends;
     int ampersand_digits;
     br_actor** non_car_list;
+    tFace_grid face_grid;                   // Added by dethrace
+    tColumn_visibility column_visibility; // Added by dethrace
 } tTrack_spec;
 
 typedef struct tCrush_neighbour {
@@ -594,7 +635,7 @@ typedef struct tPursuee_trail {
     tU8 nodes_shifted_this_frame;
 } tPursuee_trail;
 
-typedef struct tCar_spec_struct {              // size: 0x1a9c
+typedef struct tCar_spec_struct {              // size: 0x1a9c in the original game, before box_faces was added
     int index;                                 // @0x0
     int disabled;                              // @0x4
     tDriver driver;                            // @0x8
@@ -646,6 +687,10 @@ typedef struct tCar_spec_struct {              // size: 0x1a9c
     tU32 last_car_car_collision;               // @0x330
     br_scalar dt;                              // @0x334
     tCar_spec* who_last_hit_me;                // @0x338
+    // Added by dethrace: must stay in step with the end of tCollision_info.
+    // Not in the original game, so the offsets noted from here on are before box_faces and box_faces_allocated
+    tFace_ref* box_faces;
+    int box_faces_allocated;
     char name[32];                             // @0x33c
     char driver_name[32];                      // @0x35c
     char grid_icon_names[3][14];               // @0x37c
@@ -1500,7 +1545,7 @@ typedef struct tGraf_spec {
     void* base_addr;
 } tGraf_spec;
 
-typedef struct tCollision_info {          // size: 0x33c
+typedef struct tCollision_info {          // size: 0x33c in the original game, before box_faces was added
     int index;                            // @0x0
     int disabled;                         // @0x4
     tDriver driver;                       // @0x8
@@ -1552,8 +1597,13 @@ typedef struct tCollision_info {          // size: 0x33c
     tU32 last_car_car_collision;          // @0x330
     br_scalar dt;                         // @0x334
     tCar_spec* who_last_hit_me;           // @0x338
+    // Added by dethrace: faces found by GetFacesInBox, `box_face_start` and `box_face_end` index into this.
+    // Not in the original game, which ends here
+    tFace_ref* box_faces;
+    int box_faces_allocated;
 } tCollision_info;
 
+// Offsets as in the original game, tCollision_info has grown since, see box_faces
 typedef struct tNon_car_spec {      // size: 0x370
     tCollision_info collision_info; // @0x0
     br_scalar free_mass;            // @0x33c
@@ -2251,6 +2301,21 @@ typedef struct tPipe_car_data {
     tS8 rr_sus_position;
 } tPipe_car_data;
 
+// Added by dethrace: tPipe_car_data with the rotation packed into three quaternion components. Used for chunks whose
+// subject index has PIPE_CAR_PACKED set, see piping.c
+typedef struct tPipe_packed_car_data {
+    br_vector3 position;
+    br_vector3 velocity;
+    tS16 rotation[3];
+    tS16 speedo_speed;
+    tS16 steering_angle;
+    tU16 revs_and_gear;
+    tS8 lf_sus_position;
+    tS8 rf_sus_position;
+    tS8 lr_sus_position;
+    tS8 rr_sus_position;
+} tPipe_packed_car_data;
+
 typedef struct tPipe_sound_data {
     tS3_pitch pitch;
     br_vector3 position;
@@ -2387,6 +2452,7 @@ typedef struct tPipe_chunk {            // size: 0x58
         tPipe_pedestrian_data pedestrian_data;               // @0x0
         tPipe_frame_boundary_data frame_boundary_data;       // @0x0
         tPipe_car_data car_data;                             // @0x0
+        tPipe_packed_car_data packed_car_data;               // Added by dethrace
         tPipe_sound_data sound_data;                         // @0x0
         tPipe_damage_data damage_data;                       // @0x0
         tPipe_special_data special_data;                     // @0x0
@@ -2411,12 +2477,31 @@ typedef struct tPipe_chunk {            // size: 0x58
 typedef struct tPipe_session {
     tPipe_chunk_type chunk_type;
     tU8 number_of_chunks;
+    // Added by dethrace: how many sessions before this one the last of the same type was recorded, in what was padding.
+    // 0 when there is none, or it is further back than a tU16 reaches and so past gMax_rewind_chunks
+    tU16 previous_of_type_distance;
 #if defined(DETHRACE_REPLAY_DEBUG)
     int pipe_magic1;
 #endif
+    // Added by dethrace: position in recording order, and where in the pipe that last session of the same type starts
+    tU32 sequence;
+    tU32 previous_of_type_offset;
     tPipe_chunk chunks;
 } tPipe_session;
 
+// Added by dethrace: start of a file written by `--record-replays`. The race it was recorded in, to load it again
+// for `--play-replay`, followed by every session piped in that race as a tU32 length and the session itself
+typedef struct tRecorded_replay_header {
+    tU32 magic;
+    tU32 version;
+    tU32 layout;
+    int race_index;
+    int car_index;
+    char car_name[16];
+    int number_of_racers;
+    int opponent_indices[30];
+} tRecorded_replay_header;
+
 typedef struct tCollison_data {
     int ref;
     tCollision_info* car;
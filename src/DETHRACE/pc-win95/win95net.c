@@ -1,3 +1,7 @@
+// Added by dethrace: for recvmmsg and sendmmsg
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
 #include "pd/net.h"
 
 #include "brender.h"
@@ -56,6 +60,99 @@ int gSocket;
 #define MESSAGE_HEADER_STR "CW95MSG"
 #define JOINABLE_GAMES_CAPACITY 16
 
+// Added by dethrace: on Linux, datagrams are taken off the socket a batch at a time with recvmmsg, and a message for
+// every player goes out with one sendmmsg, so a busy host makes one call a frame each way rather than one per datagram
+#if defined(__linux__)
+#define RECEIVE_BATCH_SIZE 32
+
+static char gReceive_batch[RECEIVE_BATCH_SIZE][512];
+static struct sockaddr_in gReceive_batch_addrs[RECEIVE_BATCH_SIZE];
+static struct mmsghdr gReceive_batch_headers[RECEIVE_BATCH_SIZE];
+static struct iovec gReceive_batch_iovecs[RECEIVE_BATCH_SIZE];
+static int gReceive_batch_count;
+static int gReceive_batch_next;
+// the last batch emptied the socket, so the next caller to run out is told so without asking it again
+static int gReceive_batch_drained;
+
+static void ResetReceiveBatch(void) {
+    gReceive_batch_count = 0;
+    gReceive_batch_next = 0;
+    gReceive_batch_drained = 0;
+}
+
+// Stands in for recvfrom into `pBuffer`, setting gRemote_addr
+static int ReceiveDatagram(char* pBuffer, int pSize) {
+    int i;
+    int res;
+
+    if (gReceive_batch_next == gReceive_batch_count) {
+        gReceive_batch_next = 0;
+        gReceive_batch_count = 0;
+        if (gReceive_batch_drained) {
+            gReceive_batch_drained = 0;
+            errno = EWOULDBLOCK;
+            return -1;
+        }
+        for (i = 0; i < RECEIVE_BATCH_SIZE; i++) {
+            gReceive_batch_iovecs[i].iov_base = gReceive_batch[i];
+            gReceive_batch_iovecs[i].iov_len = sizeof(gReceive_batch[i]);
+            memset(&gReceive_batch_headers[i], 0, sizeof(gReceive_batch_headers[i]));
+            gReceive_batch_headers[i].msg_hdr.msg_name = &gReceive_batch_addrs[i];
+            gReceive_batch_headers[i].msg_hdr.msg_namelen = sizeof(gReceive_batch_addrs[i]);
+            gReceive_batch_headers[i].msg_hdr.msg_iov = &gReceive_batch_iovecs[i];
+            gReceive_batch_headers[i].msg_hdr.msg_iovlen = 1;
+        }
+        res = recvmmsg(gSocket, gReceive_batch_headers, RECEIVE_BATCH_SIZE, MSG_DONTWAIT, NULL);
+        if (res <= 0) {
+            if (res == 0) {
+                errno = EWOULDBLOCK;
+            }
+            return -1;
+        }
+        gReceive_batch_count = res;
+        gReceive_batch_drained = res < RECEIVE_BATCH_SIZE;
+    }
+    i = gReceive_batch_next++;
+    res = MIN((int)gReceive_batch_headers[i].msg_len, pSize);
+    memcpy(pBuffer, gReceive_batch[i], res);
+    memcpy(&gRemote_addr, &gReceive_batch_addrs[i], sizeof(gRemote_addr));
+    return res;
+}
+
+// Stands in for a sendto of `pMessage` to every other player
+static int SendToAllPlayers(tNet_message* pMessage) {
+    struct mmsghdr headers[COUNT_OF(gNet_players)];
+    struct iovec iovec;
+    int count;
+    int sent;
+    int res;
+    int i;
+
+    iovec.iov_base = pMessage;
+    iovec.iov_len = pMessage->overall_size;
+    count = 0;
+    for (i = 0; i < gNumber_of_net_players; i++) {
+        if (i == gThis_net_player_index) {
+            continue;
+        }
+        memset(&headers[count], 0, sizeof(headers[count]));
+        headers[count].msg_hdr.msg_name = &gNet_players[i].pd_net_info.addr_in;
+        headers[count].msg_hdr.msg_namelen = sizeof(gNet_players[i].pd_net_info.addr_in);
+        headers[count].msg_hdr.msg_iov = &iovec;
+        headers[count].msg_hdr.msg_iovlen = 1;
+        count++;
+    }
+    // sendmmsg stops at the first datagram it cannot send, which is reported by sending from there again
+    for (sent = 0; sent < count; sent += res) {
+        res = sendmmsg(gSocket, &headers[sent], count - sent, 0);
+        if (res <= 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+#endif
+
 DR_STATIC_ASSERT(offsetof(tNet_message, pd_stuff_so_DO_NOT_USE) == 0);
 DR_STATIC_ASSERT(offsetof(tNet_message, magic_number) == 4);
 DR_STATIC_ASSERT(offsetof(tNet_message, guarantee_number) == 8);
@@ -403,6 +500,10 @@ int PDNetShutdown(void) {
         closesocket(gSocket);
     }
     gSocket = -1;
+#if defined(__linux__)
+    // Added by dethrace: what is left came from the socket just closed
+    ResetReceiveBatch();
+#endif
     return 0;
 }
 
@@ -564,6 +665,13 @@ int PDNetSendMessageToAllPlayers(tNet_game_details* pDetails, tNet_message* pMes
     int i;
     LOG_TRACE("(%p, %p)", pDetails, pMessage);
 
+#if defined(__linux__)
+    if (SendToAllPlayers(pMessage) == -1) {
+        dr_dprintf("PDNetSendMessageToAllPlayers(): Error on sendmmsg() - WSAGetLastError=%d", WSAGetLastError());
+        NetDisposeMessage(pDetails, pMessage);
+        return 1;
+    }
+#else
     for (i = 0; i < gNumber_of_net_players; ++i) {
         if (i == gThis_net_player_index) {
             continue;
@@ -574,6 +682,7 @@ int PDNetSendMessageToAllPlayers(tNet_game_details* pDetails, tNet_message* pMes
             return 1;
         }
     }
+#endif
     NetDisposeMessage(pDetails, pMessage);
     return 0;
 }
@@ -593,7 +702,11 @@ tNet_message* PDNetGetNextMessage(tNet_game_details* pDetails, void** pSender_ad
     sa_len = sizeof(gRemote_addr);
     msg = NetAllocateMessage(512);
     receive_buffer = (char*)msg;
+#if defined(__linux__)
+    res = ReceiveDatagram(receive_buffer, 512);
+#else
     res = recvfrom(gSocket, receive_buffer, 512, 0, (struct sockaddr*)&gRemote_addr, (socklen_t *)&sa_len);
+#endif
     res = res != -1;
     if (res == 0) {
         res = WSAGetLastError() != WSAEWOULDBLOCK;
@@ -8,6 +8,7 @@
 #include "harness/config.h"
 #include "harness/hooks.h"
 #include "harness/os.h"
+#include "harness/profile.h"
 #include "harness/trace.h"
 #include "input.h"
 #include "loadsave.h"
@@ -642,11 +643,15 @@ void PDScreenBufferSwap(int pRendering_area_only) {
     } else {
         if (gReal_graf_data_index == gGraf_data_index) {
             // BrPixelmapDoubleBuffer(gScreen, gBack_screen);
+            PROFILE_ZONE_BEGIN(eProfile_zone_present);
             gHarness_platform.Renderer_Present(gBack_screen);
+            PROFILE_ZONE_END(eProfile_zone_present);
         } else {
             DRPixelmapDoubledCopy(gTemp_screen, gBack_screen, 320, 200, 0, 40);
             // BrPixelmapDoubleBuffer(gScreen, gTemp_screen);
+            PROFILE_ZONE_BEGIN(eProfile_zone_present);
             gHarness_platform.Renderer_Present(gTemp_screen);
+            PROFILE_ZONE_END(eProfile_zone_present);
         }
     }
 }
@@ -1,8 +1,13 @@
 #include "harness.h"
 #include "ascii_tables.h"
+#include "include/harness/benchmark.h"
 #include "include/harness/config.h"
 #include "include/harness/hooks.h"
+#include "include/harness/jobs.h"
 #include "include/harness/os.h"
+#include "include/harness/pack.h"
+#include "include/harness/prefetch.h"
+#include "include/harness/profile.h"
 #include "platforms/null.h"
 #include "version.h"
 
@@ -189,6 +194,10 @@ void Harness_Init(int* argc, char* argv[]) {
 
     // install signal handler by default
     harness_game_config.install_signalhandler = 1;
+    // move cars one at a time by default
+    harness_game_config.physics_threads = 1;
+    // process every opponent every frame by default
+    harness_game_config.opponent_ai_budget = 0;
 
     Harness_ProcessCommandLine(argc, argv);
 #ifndef __DREAMCAST__
@@ -215,6 +224,11 @@ void Harness_Init(int* argc, char* argv[]) {
         }
     }
 
+    // relative to the root directory, like the paths inside it
+    if (harness_game_config.pack_path[0] != '\0') {
+        Harness_Pack_Mount(harness_game_config.pack_path);
+    }
+
     if (harness_game_info.mode == eGame_none) {
         Harness_DetectGameMode();
     }
@@ -224,6 +238,16 @@ void Harness_Init(int* argc, char* argv[]) {
     } else {
         Harness_Platform_Init(&gHarness_platform);
     }
+    if (harness_game_config.benchmark_seconds > 0) {
+        Harness_Benchmark_Init(&gHarness_platform);
+    }
+    if (harness_game_config.physics_threads != 1) {
+        Harness_Jobs_Init(harness_game_config.physics_threads > 0 ? harness_game_config.physics_threads : OS_GetProcessorCount());
+    }
+    // the benchmark reads its timings from the profiler zones, even when no trace is written
+    if (harness_game_config.profile_trace_path[0] != '\0' || harness_game_config.benchmark_seconds > 0) {
+        Harness_Profile_Init(harness_game_config.profile_trace_path[0] != '\0' ? harness_game_config.profile_trace_path : NULL);
+    }
 }
 
 // used by unit tests
@@ -248,6 +272,16 @@ int Harness_ProcessCommandLine(int* argc, char* argv[]) {
             harness_game_config.physics_step_time = atoi(s + 1);
             LOG_INFO("Physics step time set to %d", harness_game_config.physics_step_time);
             handled = 1;
+        } else if (strstr(argv[i], "--physics-threads=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.physics_threads = atoi(s + 1);
+            LOG_INFO("Physics threads set to %d", harness_game_config.physics_threads);
+            handled = 1;
+        } else if (strstr(argv[i], "--ai-budget=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.opponent_ai_budget = atoi(s + 1);
+            LOG_INFO("Opponent AI budget set to %d us per frame", harness_game_config.opponent_ai_budget);
+            handled = 1;
         } else if (strstr(argv[i], "--fps=") != NULL) {
             char* s = strstr(argv[i], "=");
             harness_game_config.fps = atoi(s + 1);
@@ -257,6 +291,24 @@ int Harness_ProcessCommandLine(int* argc, char* argv[]) {
             LOG_INFO("Timer frozen");
             harness_game_config.freeze_timer = 1;
             handled = 1;
+        } else if (strcasecmp(argv[i], "--bake-pvs") == 0) {
+            LOG_INFO("Baking column visibility for tracks without a .PVS file");
+            harness_game_config.bake_pvs = 1;
+            handled = 1;
+        } else if (strstr(argv[i], "--pack=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            snprintf(harness_game_config.pack_path, sizeof(harness_game_config.pack_path), "%s", s + 1);
+            LOG_INFO("Reading game files from \"%s\"", harness_game_config.pack_path);
+            handled = 1;
+        } else if (strcasecmp(argv[i], "--record-replays") == 0) {
+            LOG_INFO("Recording the action replay of every race");
+            harness_game_config.record_replays = 1;
+            handled = 1;
+        } else if (strstr(argv[i], "--play-replay=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            snprintf(harness_game_config.play_replay_path, sizeof(harness_game_config.play_replay_path), "%s", s + 1);
+            LOG_INFO("Playing the recorded replay \"%s\"", harness_game_config.play_replay_path);
+            handled = 1;
         } else if (strcasecmp(argv[i], "--no-signal-handler") == 0) {
             LOG_INFO("Don't install the signal handler");
             harness_game_config.install_signalhandler = 0;
@@ -296,6 +348,26 @@ int Harness_ProcessCommandLine(int* argc, char* argv[]) {
         } else if (strcasecmp(argv[i], "--no-music") == 0) {
             harness_game_config.no_music = 1;
             handled = 1;
+        } else if (strcasecmp(argv[i], "--profile") == 0) {
+            strcpy(harness_game_config.profile_trace_path, "dethrace-trace.json");
+            handled = 1;
+        } else if (strstr(argv[i], "--profile=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            snprintf(harness_game_config.profile_trace_path, sizeof(harness_game_config.profile_trace_path), "%s", s + 1);
+            handled = 1;
+        } else if (strstr(argv[i], "--benchmark=") != NULL) {
+            // --benchmark=<race index or name>,<seconds>
+            char* s = strstr(argv[i], "=") + 1;
+            char* comma = strrchr(s, ',');
+            if (comma == NULL || comma == s || atoi(comma + 1) <= 0) {
+                LOG_PANIC("Expected --benchmark=<race>,<seconds>, got \"%s\"", argv[i]);
+            }
+            snprintf(harness_game_config.benchmark_race, sizeof(harness_game_config.benchmark_race), "%.*s", (int)(comma - s), s);
+            harness_game_config.benchmark_seconds = atoi(comma + 1);
+            // headless, and the race timer must not end the run early
+            force_null_platform = 1;
+            harness_game_config.freeze_timer = 1;
+            handled = 1;
         }
 
         if (handled) {
@@ -313,9 +385,23 @@ int Harness_ProcessCommandLine(int* argc, char* argv[]) {
 
 // Filesystem hooks
 FILE* Harness_Hook_fopen(const char* pathname, const char* mode) {
+    FILE* f;
+
+    f = Harness_Pack_fopen(pathname, mode);
+    if (f != NULL) {
+        return f;
+    }
+    f = Harness_Prefetch_fopen(pathname, mode);
+    if (f != NULL) {
+        return f;
+    }
     return OS_fopen(pathname, mode);
 }
 
+void Harness_Hook_FileReplaced(const char* pathname) {
+    Harness_Pack_Written(pathname);
+}
+
 // Localization
 int Harness_Hook_isalnum(int c)
 {
@@ -0,0 +1,139 @@
+#include "harness/benchmark.h"
+#include "harness/config.h"
+#include "harness/os.h"
+#include "harness/trace.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Number of clock reads without a frame boundary before the virtual clock is nudged forward by 1ms.
+// Keeps busy-wait loops (palette fades, loading screens) terminating while staying deterministic
+#define BENCHMARK_STALL_CALLS 1000
+
+static int benchmark_active;
+static uint32_t virtual_time;
+static uint32_t calls_since_frame;
+static uint32_t frame_base_time;
+static int frame_count;
+
+static uint64_t zone_accum[eProfile_zone_count];
+static uint32_t* zone_samples[eProfile_zone_count];
+static int sample_capacity;
+static uint64_t first_frame_wall_time;
+static uint64_t last_frame_wall_time;
+
+static uint32_t benchmark_get_ticks(void) {
+    calls_since_frame++;
+    if (calls_since_frame >= BENCHMARK_STALL_CALLS) {
+        calls_since_frame = 0;
+        virtual_time++;
+    }
+    return virtual_time;
+}
+
+static void benchmark_sleep(uint32_t dwMilliseconds) {
+    virtual_time += dwMilliseconds;
+}
+
+static int compare_samples(const void* a, const void* b) {
+    uint32_t sa = *(const uint32_t*)a;
+    uint32_t sb = *(const uint32_t*)b;
+    return (sa > sb) - (sa < sb);
+}
+
+void Harness_Benchmark_Init(tHarness_platform* platform) {
+    benchmark_active = 1;
+    // start well clear of 0, the game treats a zero time as "never happened"
+    virtual_time = 1000;
+    platform->GetTicks = benchmark_get_ticks;
+    platform->Sleep = benchmark_sleep;
+    LOG_INFO("Benchmarking race \"%s\" for %d seconds", harness_game_config.benchmark_race, harness_game_config.benchmark_seconds);
+}
+
+int Harness_Benchmark_IsActive(void) {
+    return benchmark_active;
+}
+
+void Harness_Benchmark_AddZoneTime(tHarness_profile_zone zone, uint32_t microseconds) {
+    if (!benchmark_active) {
+        return;
+    }
+    zone_accum[zone] += microseconds;
+}
+
+int Harness_Benchmark_EndFrame(void) {
+    uint32_t target_time;
+    int i;
+
+    if (!benchmark_active) {
+        return 0;
+    }
+    if (frame_count == 0) {
+        frame_base_time = virtual_time;
+        first_frame_wall_time = OS_GetMicroseconds();
+    }
+    if (frame_count == sample_capacity) {
+        sample_capacity = sample_capacity ? sample_capacity * 2 : 1024;
+        for (i = 0; i < eProfile_zone_count; i++) {
+            zone_samples[i] = realloc(zone_samples[i], sample_capacity * sizeof(uint32_t));
+            if (zone_samples[i] == NULL) {
+                LOG_PANIC("Failed to allocate benchmark samples");
+            }
+        }
+    }
+    for (i = 0; i < eProfile_zone_count; i++) {
+        zone_samples[i][frame_count] = (uint32_t)zone_accum[i];
+        zone_accum[i] = 0;
+    }
+    frame_count++;
+    last_frame_wall_time = OS_GetMicroseconds();
+
+    target_time = frame_base_time + (uint32_t)((uint64_t)frame_count * BENCHMARK_FRAME_PERIOD_NUM / BENCHMARK_FRAME_PERIOD_DEN);
+    if ((int32_t)(target_time - virtual_time) > 0) {
+        virtual_time = target_time;
+    }
+    calls_since_frame = 0;
+
+    return (uint64_t)frame_count * BENCHMARK_FRAME_PERIOD_NUM / BENCHMARK_FRAME_PERIOD_DEN >= (uint64_t)harness_game_config.benchmark_seconds * 1000;
+}
+
+void Harness_Benchmark_Report(void) {
+    uint32_t* sorted;
+    uint64_t total;
+    int i;
+    int j;
+
+    if (!benchmark_active) {
+        return;
+    }
+    printf("Benchmark: race \"%s\", %d frames, %.3f s virtual, %.3f s wall\n",
+        harness_game_config.benchmark_race,
+        frame_count,
+        frame_count * (double)BENCHMARK_FRAME_PERIOD_NUM / BENCHMARK_FRAME_PERIOD_DEN / 1000.0,
+        (last_frame_wall_time - first_frame_wall_time) / 1000000.0);
+    if (frame_count == 0) {
+        return;
+    }
+    sorted = malloc(frame_count * sizeof(uint32_t));
+    if (sorted == NULL) {
+        LOG_PANIC("Failed to allocate benchmark samples");
+    }
+    printf("  %-30s %10s %10s %10s  (ms)\n", "zone", "min", "mean", "p99");
+    for (i = 0; i < eProfile_zone_count; i++) {
+        memcpy(sorted, zone_samples[i], frame_count * sizeof(uint32_t));
+        qsort(sorted, frame_count, sizeof(uint32_t), compare_samples);
+        total = 0;
+        for (j = 0; j < frame_count; j++) {
+            total += sorted[j];
+        }
+        printf("  %-30s %10.3f %10.3f %10.3f\n",
+            Harness_Profile_ZoneName(i),
+            sorted[0] / 1000.0,
+            total / (double)frame_count / 1000.0,
+            sorted[(frame_count - 1) * 99 / 100] / 1000.0);
+    }
+    free(sorted);
+    fflush(stdout);
+}
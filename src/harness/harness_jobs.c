@@ -0,0 +1,119 @@
+#include "harness/jobs.h"
+#include "harness/compiler.h"
+#include "harness/os.h"
+#include "harness/trace.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+static int worker_count;
+static void* workers[HARNESS_JOBS_MAX_THREADS - 1];
+static void* start_semaphore;
+static void* done_semaphore;
+static long quit;
+
+// Published to the workers by posting `start_semaphore`
+static tHarness_job_func* batch_func;
+static void* batch_context;
+static long batch_count;
+static long batch_next;
+
+static void run_batch(void) {
+    long index;
+
+    for (;;) {
+        index = HARNESS_ATOMIC_FETCH_ADD(&batch_next, 1);
+        if (index >= batch_count) {
+            break;
+        }
+        batch_func(batch_context, (int)index);
+    }
+}
+
+static void worker_main(void* arg) {
+    for (;;) {
+        OS_SemaphoreWait(start_semaphore);
+        if (HARNESS_ATOMIC_LOAD(&quit)) {
+            return;
+        }
+        run_batch();
+        OS_SemaphorePost(done_semaphore);
+    }
+}
+
+static void jobs_atexit(void) {
+    Harness_Jobs_Shutdown();
+}
+
+void Harness_Jobs_Init(int thread_count) {
+    if (thread_count > HARNESS_JOBS_MAX_THREADS) {
+        thread_count = HARNESS_JOBS_MAX_THREADS;
+    }
+    if (thread_count <= 1 || worker_count != 0) {
+        return;
+    }
+    start_semaphore = OS_CreateSemaphore(0);
+    done_semaphore = OS_CreateSemaphore(0);
+    if (start_semaphore == NULL || done_semaphore == NULL) {
+        LOG_WARN("Failed to create job semaphores, running jobs on the main thread");
+        return;
+    }
+    while (worker_count < thread_count - 1) {
+        workers[worker_count] = OS_CreateThread(worker_main, NULL);
+        if (workers[worker_count] == NULL) {
+            LOG_WARN("Failed to start job thread %d", worker_count + 1);
+            break;
+        }
+        worker_count++;
+    }
+    if (worker_count != 0) {
+        atexit(jobs_atexit);
+    }
+    LOG_INFO("Running jobs on %d threads", worker_count + 1);
+}
+
+int Harness_Jobs_ThreadCount(void) {
+    return worker_count + 1;
+}
+
+void Harness_Jobs_ParallelFor(tHarness_job_func* func, void* context, int count) {
+    int i;
+    int wake;
+
+    if (worker_count == 0 || count <= 1) {
+        for (i = 0; i < count; i++) {
+            func(context, i);
+        }
+        return;
+    }
+    batch_func = func;
+    batch_context = context;
+    batch_count = count;
+    HARNESS_ATOMIC_STORE(&batch_next, 0);
+    wake = count - 1 < worker_count ? count - 1 : worker_count;
+    for (i = 0; i < wake; i++) {
+        OS_SemaphorePost(start_semaphore);
+    }
+    run_batch();
+    for (i = 0; i < wake; i++) {
+        OS_SemaphoreWait(done_semaphore);
+    }
+}
+
+void Harness_Jobs_Shutdown(void) {
+    int i;
+
+    if (worker_count == 0) {
+        return;
+    }
+    HARNESS_ATOMIC_STORE(&quit, 1);
+    for (i = 0; i < worker_count; i++) {
+        OS_SemaphorePost(start_semaphore);
+    }
+    for (i = 0; i < worker_count; i++) {
+        OS_JoinThread(workers[i]);
+    }
+    worker_count = 0;
+    OS_DestroySemaphore(start_semaphore);
+    OS_DestroySemaphore(done_semaphore);
+}
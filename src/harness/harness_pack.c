@@ -0,0 +1,247 @@
+#include "harness/pack.h"
+#include "harness/os.h"
+#include "harness/trace.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Layout written by tools/pack_data.py, all numbers 32-bit little endian:
+//   header   magic, version, entry_count, bucket_count, buckets_offset, entries_offset, names_offset, data_offset
+//   entries  entry_count of { hash, name_offset, name_length, data_offset, data_size }
+//   buckets  bucket_count (a power of two) of entry index + 1, 0 when empty, probed linearly from hash
+//   names    folded paths: lower case, '/' separated, relative to the root directory
+//   data     each file's bytes
+#define PACK_MAGIC 0x4b415044 // "DPAK"
+#define PACK_VERSION 1
+#define PACK_HEADER_WORDS 8
+#define PACK_ENTRY_WORDS 5
+
+static uint8_t* pack_data;
+static size_t pack_size;
+static uint32_t entry_count;
+static uint32_t bucket_mask;
+static const uint8_t* entries;
+static const uint8_t* buckets;
+static const uint8_t* names;
+// set for entries opened for writing since the archive was mounted, disk has the current copy
+static uint8_t* entry_written;
+// the current directory when mounted, folded, with a trailing '/'
+static char root[512];
+static size_t root_length;
+
+static uint32_t read_u32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// FNV-1a, as tools/pack_data.py
+static uint32_t hash_path(const char* path, size_t length) {
+    uint32_t hash = 0x811c9dc5;
+
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)path[i]) * 0x01000193;
+    }
+    return hash;
+}
+
+// Lower case, '/' separated, no repeated separators and no "." components
+static int fold_path(const char* path, char* folded, size_t folded_size) {
+    size_t length = 0;
+
+    for (const char* p = path; *p != '\0'; p++) {
+        char c = *p == '\\' ? '/' : (char)tolower((unsigned char)*p);
+        if (c == '/' && length != 0 && folded[length - 1] == '/') {
+            continue;
+        }
+        if (c == '.' && (length == 0 || folded[length - 1] == '/') && (p[1] == '/' || p[1] == '\\')) {
+            p++;
+            continue;
+        }
+        if (length + 1 >= folded_size) {
+            return 0;
+        }
+        folded[length++] = c;
+    }
+    folded[length] = '\0';
+    return 1;
+}
+
+static int find_entry(const char* pathname) {
+    char folded[512];
+    const char* relative;
+    size_t length;
+    uint32_t hash;
+    uint32_t bucket;
+    uint32_t index;
+    uint32_t probes;
+    const uint8_t* entry;
+
+    if (!fold_path(pathname, folded, sizeof(folded))) {
+        return -1;
+    }
+    relative = folded;
+    if (strncmp(folded, root, root_length) == 0) {
+        relative = folded + root_length;
+    } else if (folded[0] == '/' || (folded[0] != '\0' && folded[1] == ':')) {
+        // absolute, and somewhere other than the root
+        return -1;
+    }
+    length = strlen(relative);
+    hash = hash_path(relative, length);
+    // a table with no empty bucket left would otherwise be probed for ever
+    for (bucket = hash & bucket_mask, probes = 0; probes <= bucket_mask; bucket = (bucket + 1) & bucket_mask, probes++) {
+        index = read_u32(buckets + 4 * bucket);
+        if (index == 0) {
+            return -1;
+        }
+        entry = entries + (index - 1) * PACK_ENTRY_WORDS * 4;
+        if (read_u32(entry) == hash
+            && read_u32(entry + 8) == length
+            && memcmp(names + read_u32(entry + 4), relative, length) == 0) {
+            return index - 1;
+        }
+    }
+    return -1;
+}
+
+static void pack_atexit(void) {
+    Harness_Pack_Unmount();
+}
+
+int Harness_Pack_Mount(const char* path) {
+    uint32_t buckets_offset;
+    uint32_t entries_offset;
+    uint32_t names_offset;
+    uint32_t bucket_count;
+    FILE* probe;
+    char cwd[512];
+
+    if (pack_data != NULL) {
+        return 1;
+    }
+    pack_data = OS_MapFile(path, &pack_size);
+    if (pack_data == NULL) {
+        LOG_WARN("Could not map \"%s\", reading files from disk", path);
+        return 0;
+    }
+    if (pack_size < PACK_HEADER_WORDS * 4 || read_u32(pack_data) != PACK_MAGIC || read_u32(pack_data + 4) != PACK_VERSION) {
+        LOG_WARN("\"%s\" is not a version %d pack, reading files from disk", path, PACK_VERSION);
+        Harness_Pack_Unmount();
+        return 0;
+    }
+    entry_count = read_u32(pack_data + 8);
+    bucket_count = read_u32(pack_data + 12);
+    buckets_offset = read_u32(pack_data + 16);
+    entries_offset = read_u32(pack_data + 20);
+    names_offset = read_u32(pack_data + 24);
+    if (bucket_count == 0 || (bucket_count & (bucket_count - 1)) != 0 || bucket_count <= entry_count
+        || buckets_offset > pack_size || (pack_size - buckets_offset) / 4 < bucket_count
+        || entries_offset > pack_size || (pack_size - entries_offset) / (PACK_ENTRY_WORDS * 4) < entry_count
+        || names_offset > pack_size) {
+        LOG_WARN("\"%s\" is damaged, reading files from disk", path);
+        Harness_Pack_Unmount();
+        return 0;
+    }
+    entries = pack_data + entries_offset;
+    buckets = pack_data + buckets_offset;
+    names = pack_data + names_offset;
+    bucket_mask = bucket_count - 1;
+    for (uint32_t i = 0; i < bucket_count; i++) {
+        if (read_u32(buckets + 4 * i) > entry_count) {
+            LOG_WARN("\"%s\" is damaged, reading files from disk", path);
+            Harness_Pack_Unmount();
+            return 0;
+        }
+    }
+    for (uint32_t i = 0; i < entry_count; i++) {
+        const uint8_t* entry = entries + i * PACK_ENTRY_WORDS * 4;
+        if (read_u32(entry + 4) > pack_size - names_offset
+            || read_u32(entry + 8) > pack_size - names_offset - read_u32(entry + 4)
+            || read_u32(entry + 12) > pack_size
+            || read_u32(entry + 16) > pack_size - read_u32(entry + 12)) {
+            LOG_WARN("\"%s\" is damaged, reading files from disk", path);
+            Harness_Pack_Unmount();
+            return 0;
+        }
+    }
+    // somewhere without a stream over memory has nothing to serve them with
+    probe = OS_OpenMemory(pack_data, pack_size);
+    if (probe == NULL) {
+        LOG_WARN("Reading from memory is not supported here, reading files from disk");
+        Harness_Pack_Unmount();
+        return 0;
+    }
+    fclose(probe);
+    entry_written = calloc(entry_count > 0 ? entry_count : 1, 1);
+    root[0] = '\0';
+    root_length = 0;
+    if (getcwd(cwd, sizeof(cwd) - 1) != NULL) {
+        strcat(cwd, "/");
+        if (fold_path(cwd, root, sizeof(root))) {
+            root_length = strlen(root);
+        }
+    }
+    atexit(pack_atexit);
+    LOG_INFO("Serving %u files from \"%s\"", (unsigned)entry_count, path);
+    return 1;
+}
+
+int Harness_Pack_Contains(const char* pathname) {
+    int index;
+
+    if (pack_data == NULL) {
+        return 0;
+    }
+    index = find_entry(pathname);
+    return index >= 0 && !entry_written[index] && read_u32(entries + index * PACK_ENTRY_WORDS * 4 + 16) != 0;
+}
+
+FILE* Harness_Pack_fopen(const char* pathname, const char* mode) {
+    int index;
+    const uint8_t* entry;
+
+    if (pack_data == NULL) {
+        return NULL;
+    }
+    index = find_entry(pathname);
+    if (index < 0) {
+        return NULL;
+    }
+    if (strpbrk(mode, "wa+") != NULL) {
+        entry_written[index] = 1;
+        return NULL;
+    }
+    if (entry_written[index]) {
+        return NULL;
+    }
+    entry = entries + index * PACK_ENTRY_WORDS * 4;
+    // not every platform allows an empty stream over memory, so empty files are read from disk
+    if (read_u32(entry + 16) == 0) {
+        return NULL;
+    }
+    return OS_OpenMemory(pack_data + read_u32(entry + 12), read_u32(entry + 16));
+}
+
+void Harness_Pack_Written(const char* pathname) {
+    int index;
+
+    if (pack_data == NULL) {
+        return;
+    }
+    index = find_entry(pathname);
+    if (index >= 0) {
+        entry_written[index] = 1;
+    }
+}
+
+void Harness_Pack_Unmount(void) {
+    if (pack_data == NULL) {
+        return;
+    }
+    OS_UnmapFile(pack_data, pack_size);
+    pack_data = NULL;
+    pack_size = 0;
+    free(entry_written);
+    entry_written = NULL;
+}
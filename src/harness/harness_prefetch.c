@@ -0,0 +1,161 @@
+#include "harness/prefetch.h"
+#include "harness/compiler.h"
+#include "harness/os.h"
+#include "harness/pack.h"
+#include "harness/trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum tPrefetch_state {
+    ePrefetch_queued,
+    ePrefetch_ready,
+    ePrefetch_failed
+} tPrefetch_state;
+
+typedef struct tPrefetch_entry {
+    char* path;
+    void* data;
+    size_t size;
+    // tPrefetch_state, written by the reader thread once `data` and `size` are set
+    long state;
+} tPrefetch_entry;
+
+static tPrefetch_entry* batch;
+static int batch_count;
+static void* reader;
+// posted by the reader thread every time an entry leaves ePrefetch_queued
+static void* progress_semaphore;
+// posts taken by Harness_Prefetch_fopen since the batch started
+static int progress_taken;
+static long cancel;
+// -1 until a stream over memory has been tried, then whether one can be opened
+static int memory_streams = -1;
+
+static void read_entry(tPrefetch_entry* entry) {
+    FILE* f;
+    long size;
+
+    f = OS_fopen(entry->path, "rb");
+    if (f == NULL) {
+        return;
+    }
+    if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 0 && fseek(f, 0, SEEK_SET) == 0) {
+        entry->data = malloc(size);
+        if (entry->data != NULL && fread(entry->data, 1, size, f) == (size_t)size) {
+            entry->size = size;
+        } else {
+            free(entry->data);
+            entry->data = NULL;
+        }
+    }
+    fclose(f);
+}
+
+static void reader_main(void* arg) {
+    for (int i = 0; i < batch_count; i++) {
+        if (!HARNESS_ATOMIC_LOAD(&cancel)) {
+            read_entry(&batch[i]);
+        }
+        HARNESS_ATOMIC_STORE(&batch[i].state, batch[i].data != NULL ? ePrefetch_ready : ePrefetch_failed);
+        OS_SemaphorePost(progress_semaphore);
+    }
+}
+
+static int can_open_memory(void) {
+    char probe = 0;
+    FILE* f;
+
+    if (memory_streams < 0) {
+        f = OS_OpenMemory(&probe, sizeof(probe));
+        memory_streams = f != NULL;
+        if (f != NULL) {
+            fclose(f);
+        }
+    }
+    return memory_streams;
+}
+
+void Harness_Prefetch_Files(const char* const* paths, int count) {
+    Harness_Prefetch_Release();
+    if (count <= 0 || !can_open_memory()) {
+        return;
+    }
+    if (progress_semaphore == NULL) {
+        progress_semaphore = OS_CreateSemaphore(0);
+        if (progress_semaphore == NULL) {
+            return;
+        }
+    }
+    batch = calloc(count, sizeof(tPrefetch_entry));
+    if (batch == NULL) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        // the pack already has these in memory
+        if (Harness_Pack_Contains(paths[i])) {
+            continue;
+        }
+        batch[batch_count].path = strdup(paths[i]);
+        if (batch[batch_count].path != NULL) {
+            batch_count++;
+        }
+    }
+    if (batch_count == 0) {
+        Harness_Prefetch_Release();
+        return;
+    }
+    HARNESS_ATOMIC_STORE(&cancel, 0);
+    reader = OS_CreateThread(reader_main, NULL);
+    if (reader == NULL) {
+        LOG_WARN("Failed to start the prefetch thread, reading files as they are opened");
+        Harness_Prefetch_Release();
+    }
+}
+
+FILE* Harness_Prefetch_fopen(const char* pathname, const char* mode) {
+    tPrefetch_entry* entry;
+    long state;
+
+    if (reader == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < batch_count; i++) {
+        entry = &batch[i];
+        if (strcmp(entry->path, pathname) != 0) {
+            continue;
+        }
+        if (strpbrk(mode, "wa+") != NULL) {
+            return NULL;
+        }
+        while ((state = HARNESS_ATOMIC_LOAD(&entry->state)) == ePrefetch_queued) {
+            OS_SemaphoreWait(progress_semaphore);
+            progress_taken++;
+        }
+        if (state != ePrefetch_ready) {
+            return NULL;
+        }
+        return OS_OpenMemory(entry->data, entry->size);
+    }
+    return NULL;
+}
+
+void Harness_Prefetch_Release(void) {
+    if (reader != NULL) {
+        HARNESS_ATOMIC_STORE(&cancel, 1);
+        OS_JoinThread(reader);
+        reader = NULL;
+        // drain the posts nobody waited for, so the next batch starts at zero
+        for (; progress_taken < batch_count; progress_taken++) {
+            OS_SemaphoreWait(progress_semaphore);
+        }
+    }
+    progress_taken = 0;
+    for (int i = 0; i < batch_count; i++) {
+        free(batch[i].path);
+        free(batch[i].data);
+    }
+    free(batch);
+    batch = NULL;
+    batch_count = 0;
+}
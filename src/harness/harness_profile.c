@@ -0,0 +1,181 @@
+#include "harness/profile.h"
+#include "harness/benchmark.h"
+#include "harness/compiler.h"
+#include "harness/os.h"
+#include "harness/trace.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Events kept per thread. Older events are overwritten once the ring is full
+#define PROFILE_RING_SIZE (1 << 16)
+#define PROFILE_MAX_THREADS 16
+#define PROFILE_MAX_DEPTH 32
+
+typedef struct tProfile_event {
+    uint64_t start;
+    uint32_t duration;
+    uint32_t zone;
+} tProfile_event;
+
+// Written only by its owning thread. `head` is published after each event so a dump can read concurrently
+typedef struct tProfile_thread {
+    int index;
+    long head;
+    int depth;
+    uint64_t stack[PROFILE_MAX_DEPTH];
+    tProfile_event events[PROFILE_RING_SIZE];
+} tProfile_thread;
+
+static const char* zone_names[eProfile_zone_count] = {
+    "NetReceiveAndProcessMessages",
+    "MungeOpponents",
+    "ApplyPhysicsToCars",
+    "PipeCarPositions",
+    "MungeCarGraphics",
+    "MungePedestrians",
+    "RenderAFrame",
+    "Renderer_Present",
+    "MoveCarJob",
+};
+
+int harness_profile_active;
+
+static char trace_path[256];
+static uint64_t base_time;
+static long thread_count;
+static tProfile_thread* threads[PROFILE_MAX_THREADS];
+static HARNESS_THREAD_LOCAL tProfile_thread* this_thread;
+static HARNESS_THREAD_LOCAL int this_thread_unregistered;
+
+static tProfile_thread* get_thread(void) {
+    long index;
+
+    if (this_thread != NULL || this_thread_unregistered) {
+        return this_thread;
+    }
+    index = HARNESS_ATOMIC_FETCH_ADD(&thread_count, 1);
+    if (index >= PROFILE_MAX_THREADS) {
+        this_thread_unregistered = 1;
+        return NULL;
+    }
+    this_thread = calloc(1, sizeof(tProfile_thread));
+    if (this_thread == NULL) {
+        LOG_PANIC("Failed to allocate profile ring buffer");
+    }
+    this_thread->index = index;
+    threads[index] = this_thread;
+    return this_thread;
+}
+
+static void profile_atexit(void) {
+    Harness_Profile_Dump();
+}
+
+void Harness_Profile_Init(const char* path) {
+    base_time = OS_GetMicroseconds();
+    // the calling thread is registered first, it is the main thread
+    get_thread();
+    if (path != NULL) {
+        snprintf(trace_path, sizeof(trace_path), "%s", path);
+        atexit(profile_atexit);
+        LOG_INFO("Profiling to \"%s\" (dump with ctrl+F12)", trace_path);
+    }
+    harness_profile_active = 1;
+}
+
+void Harness_Profile_ZoneBegin(tHarness_profile_zone zone) {
+    tProfile_thread* t;
+
+    t = get_thread();
+    if (t == NULL) {
+        return;
+    }
+    if (t->depth < PROFILE_MAX_DEPTH) {
+        t->stack[t->depth] = OS_GetMicroseconds();
+    }
+    t->depth++;
+}
+
+void Harness_Profile_ZoneEnd(tHarness_profile_zone zone) {
+    tProfile_thread* t;
+    tProfile_event* event;
+    uint64_t now;
+    uint64_t start;
+
+    t = get_thread();
+    if (t == NULL || t->depth == 0) {
+        return;
+    }
+    t->depth--;
+    if (t->depth >= PROFILE_MAX_DEPTH) {
+        return;
+    }
+    now = OS_GetMicroseconds();
+    start = t->stack[t->depth];
+    if (trace_path[0] != '\0') {
+        event = &t->events[t->head & (PROFILE_RING_SIZE - 1)];
+        event->start = start;
+        event->duration = (uint32_t)(now - start);
+        event->zone = zone;
+        HARNESS_ATOMIC_STORE(&t->head, t->head + 1);
+    }
+    if (t->index == 0) {
+        Harness_Benchmark_AddZoneTime(zone, (uint32_t)(now - start));
+    }
+}
+
+void Harness_Profile_Dump(void) {
+    FILE* f;
+    tProfile_thread* t;
+    tProfile_event* event;
+    long count;
+    long head;
+    long first;
+    long i;
+    int j;
+    int separator;
+
+    if (trace_path[0] == '\0') {
+        return;
+    }
+    f = fopen(trace_path, "w");
+    if (f == NULL) {
+        LOG_WARN("Failed to open \"%s\" for writing", trace_path);
+        return;
+    }
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    separator = 0;
+    count = HARNESS_ATOMIC_LOAD(&thread_count);
+    if (count > PROFILE_MAX_THREADS) {
+        count = PROFILE_MAX_THREADS;
+    }
+    for (j = 0; j < count; j++) {
+        t = threads[j];
+        if (t == NULL) {
+            continue;
+        }
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            separator ? ",\n" : "", j, j == 0 ? "main" : "worker");
+        separator = 1;
+        head = HARNESS_ATOMIC_LOAD(&t->head);
+        first = head > PROFILE_RING_SIZE ? head - PROFILE_RING_SIZE : 0;
+        for (i = first; i < head; i++) {
+            event = &t->events[i & (PROFILE_RING_SIZE - 1)];
+            fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%llu,\"dur\":%u}",
+                Harness_Profile_ZoneName(event->zone), j, (unsigned long long)(event->start - base_time), event->duration);
+        }
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    LOG_INFO("Wrote profile trace \"%s\"", trace_path);
+}
+
+const char* Harness_Profile_ZoneName(tHarness_profile_zone zone) {
+    if ((unsigned)zone >= eProfile_zone_count) {
+        return "unknown";
+    }
+    return zone_names[zone];
+}
@@ -0,0 +1,150 @@
+#include "harness/writer.h"
+#include "harness/compiler.h"
+#include "harness/os.h"
+#include "harness/trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WRITER_BLOCK_SIZE (64 * 1024)
+// blocks waiting for the thread before handing over one more has to wait for the disk
+#define WRITER_QUEUE_LENGTH 64
+
+typedef struct tWriter_block {
+    size_t size;
+    unsigned char data[WRITER_BLOCK_SIZE];
+} tWriter_block;
+
+struct tHarness_writer {
+    FILE* file;
+    // NULL when blocks are written by the caller, as they are handed over
+    void* thread;
+    // posted for every block put in `queue`, and for the NULL that stops the thread
+    void* queued_semaphore;
+    // posted for every slot of `queue` the thread is done with
+    void* free_semaphore;
+    tWriter_block* queue[WRITER_QUEUE_LENGTH];
+    // only used by the caller
+    int queue_tail;
+    // only used by the thread
+    int queue_head;
+    tWriter_block* current;
+    long failed;
+};
+
+static void write_block(tHarness_writer* writer, tWriter_block* block) {
+    if (!HARNESS_ATOMIC_LOAD(&writer->failed)
+        && (fwrite(block->data, 1, block->size, writer->file) != block->size || fflush(writer->file) != 0)) {
+        HARNESS_ATOMIC_STORE(&writer->failed, 1);
+    }
+    free(block);
+}
+
+static void writer_main(void* arg) {
+    tHarness_writer* writer = arg;
+    tWriter_block* block;
+
+    for (;;) {
+        OS_SemaphoreWait(writer->queued_semaphore);
+        block = writer->queue[writer->queue_head];
+        writer->queue_head = (writer->queue_head + 1) % WRITER_QUEUE_LENGTH;
+        OS_SemaphorePost(writer->free_semaphore);
+        if (block == NULL) {
+            return;
+        }
+        write_block(writer, block);
+    }
+}
+
+static void hand_over(tHarness_writer* writer, tWriter_block* block) {
+    if (writer->thread == NULL) {
+        if (block != NULL) {
+            write_block(writer, block);
+        }
+        return;
+    }
+    OS_SemaphoreWait(writer->free_semaphore);
+    writer->queue[writer->queue_tail] = block;
+    writer->queue_tail = (writer->queue_tail + 1) % WRITER_QUEUE_LENGTH;
+    OS_SemaphorePost(writer->queued_semaphore);
+}
+
+tHarness_writer* Harness_Writer_Open(const char* path) {
+    tHarness_writer* writer;
+
+    writer = calloc(1, sizeof(tHarness_writer));
+    if (writer == NULL) {
+        return NULL;
+    }
+    writer->file = OS_fopen(path, "wb");
+    if (writer->file == NULL) {
+        free(writer);
+        return NULL;
+    }
+    writer->queued_semaphore = OS_CreateSemaphore(0);
+    writer->free_semaphore = OS_CreateSemaphore(WRITER_QUEUE_LENGTH);
+    if (writer->queued_semaphore != NULL && writer->free_semaphore != NULL) {
+        writer->thread = OS_CreateThread(writer_main, writer);
+    }
+    if (writer->thread == NULL) {
+        LOG_WARN("Failed to start a thread to write \"%s\", writing it as it is flushed", path);
+    }
+    return writer;
+}
+
+void Harness_Writer_Write(tHarness_writer* writer, const void* data, size_t size) {
+    size_t part;
+
+    while (size != 0) {
+        if (writer->current == NULL) {
+            writer->current = malloc(sizeof(tWriter_block));
+            if (writer->current == NULL) {
+                HARNESS_ATOMIC_STORE(&writer->failed, 1);
+                return;
+            }
+            writer->current->size = 0;
+        }
+        part = WRITER_BLOCK_SIZE - writer->current->size;
+        if (part > size) {
+            part = size;
+        }
+        memcpy(writer->current->data + writer->current->size, data, part);
+        writer->current->size += part;
+        data = (const unsigned char*)data + part;
+        size -= part;
+        if (writer->current->size == WRITER_BLOCK_SIZE) {
+            Harness_Writer_Flush(writer);
+        }
+    }
+}
+
+void Harness_Writer_Flush(tHarness_writer* writer) {
+    if (writer->current != NULL && writer->current->size != 0) {
+        hand_over(writer, writer->current);
+        writer->current = NULL;
+    }
+}
+
+int Harness_Writer_Close(tHarness_writer* writer) {
+    int ok;
+
+    Harness_Writer_Flush(writer);
+    free(writer->current);
+    if (writer->thread != NULL) {
+        hand_over(writer, NULL);
+        OS_JoinThread(writer->thread);
+    }
+    if (writer->queued_semaphore != NULL) {
+        OS_DestroySemaphore(writer->queued_semaphore);
+    }
+    if (writer->free_semaphore != NULL) {
+        OS_DestroySemaphore(writer->free_semaphore);
+    }
+    ok = !HARNESS_ATOMIC_LOAD(&writer->failed);
+    if (fclose(writer->file) != 0) {
+        ok = 0;
+    }
+    free(writer);
+    return ok;
+}
@@ -0,0 +1,25 @@
+#ifndef HARNESS_BENCHMARK_H
+#define HARNESS_BENCHMARK_H
+
+#include "harness/hooks.h"
+#include "harness/profile.h"
+
+// Virtual frame period used while racing, in milliseconds (30 fps)
+#define BENCHMARK_FRAME_PERIOD_NUM 1000
+#define BENCHMARK_FRAME_PERIOD_DEN 30
+
+// Replace the platform clock with the deterministic benchmark clock
+void Harness_Benchmark_Init(tHarness_platform* platform);
+
+int Harness_Benchmark_IsActive(void);
+
+// Called by the profiler as each main thread zone closes
+void Harness_Benchmark_AddZoneTime(tHarness_profile_zone zone, uint32_t microseconds);
+
+// Advance the virtual clock by one frame. Returns non-zero once the requested duration has been raced
+int Harness_Benchmark_EndFrame(void);
+
+// Print min/mean/p99 per-frame times for each profile zone
+void Harness_Benchmark_Report(void);
+
+#endif
@@ -2,9 +2,18 @@
 #define HARNESS_COMPILER_H
 
 #if defined(_MSC_VER)
+#include <intrin.h>
 #define HARNESS_NORETURN __declspec(noreturn)
+#define HARNESS_THREAD_LOCAL __declspec(thread)
+#define HARNESS_ATOMIC_FETCH_ADD(PTR, VALUE) _InterlockedExchangeAdd((volatile long*)(PTR), (VALUE))
+#define HARNESS_ATOMIC_LOAD(PTR) _InterlockedOr((volatile long*)(PTR), 0)
+#define HARNESS_ATOMIC_STORE(PTR, VALUE) _InterlockedExchange((volatile long*)(PTR), (VALUE))
 #else
 #define HARNESS_NORETURN __attribute__((noreturn))
+#define HARNESS_THREAD_LOCAL __thread
+#define HARNESS_ATOMIC_FETCH_ADD(PTR, VALUE) __atomic_fetch_add((PTR), (VALUE), __ATOMIC_ACQ_REL)
+#define HARNESS_ATOMIC_LOAD(PTR) __atomic_load_n((PTR), __ATOMIC_ACQUIRE)
+#define HARNESS_ATOMIC_STORE(PTR, VALUE) __atomic_store_n((PTR), (VALUE), __ATOMIC_RELEASE)
 #endif
 
 #endif
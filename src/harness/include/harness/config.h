@@ -49,6 +49,31 @@ typedef struct tHarness_game_config {
     int verbose;
 
     int install_signalhandler;
+
+    // threads moving cars in parallel during a physics step, see `--physics-threads=<n>`. 0 uses every processor
+    int physics_threads;
+
+    // microseconds per frame the opponent AI may spend before deferring distant opponents, see `--ai-budget=<us>`. 0 processes every opponent every frame
+    int opponent_ai_budget;
+
+    // bake a .PVS column visibility file for each track loaded without one, see `--bake-pvs`
+    int bake_pvs;
+
+    // archive built by tools/pack_data.py to read the game's files from, see `--pack=<file>`. Empty when reading from disk
+    char pack_path[256];
+
+    // stream the action replay of every race to a REPLAYnnn.RPL file, see `--record-replays`
+    int record_replays;
+
+    // file written by `--record-replays` to watch instead of racing, see `--play-replay=<file>`. Empty when racing
+    char play_replay_path[256];
+
+    // headless benchmark race, see `--benchmark=<race>,<seconds>`
+    char benchmark_race[32];
+    int benchmark_seconds;
+
+    // Chrome/Perfetto trace output of the frame profiler, see `--profile[=<file>]`. Empty when not profiling
+    char profile_trace_path[256];
 } tHarness_game_config;
 
 extern tHarness_game_info harness_game_info;
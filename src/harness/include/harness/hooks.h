@@ -44,6 +44,7 @@ void Harness_Init(int* argc, char* argv[]);
 
 // Filesystem hooks
 FILE* Harness_Hook_fopen(const char* pathname, const char* mode);
+void Harness_Hook_FileReplaced(const char* pathname);
 
 // Localization
 int Harness_Hook_isalnum(int c);
@@ -0,0 +1,23 @@
+#ifndef HARNESS_JOBS_H
+#define HARNESS_JOBS_H
+
+// Upper bound on the threads sharing a job batch, including the calling thread
+#define HARNESS_JOBS_MAX_THREADS 16
+
+typedef void tHarness_job_func(void* context, int index);
+
+// Start `thread_count - 1` worker threads, the calling thread makes up the last one.
+// With 1 or fewer threads every job runs on the calling thread
+void Harness_Jobs_Init(int thread_count);
+
+// Number of threads that share a batch, including the calling thread
+int Harness_Jobs_ThreadCount(void);
+
+// Run `func(context, index)` for every index in [0, count) and wait for all of them to finish.
+// Jobs start in index order but may finish in any order. Must only be called from the main thread
+void Harness_Jobs_ParallelFor(tHarness_job_func* func, void* context, int count);
+
+// Stop and join the worker threads
+void Harness_Jobs_Shutdown(void);
+
+#endif
@@ -36,4 +36,33 @@ char* OS_Basename(const char* path);
 
 char* OS_GetWorkingDirectory(char* argv0);
 
+// Monotonic high resolution clock, in microseconds. Only differences between two calls are meaningful
+uint64_t OS_GetMicroseconds(void);
+
+// Number of processors available to run threads on, at least 1
+int OS_GetProcessorCount(void);
+
+// Start running `func(arg)` on a new thread. Returns NULL when the thread could not be created
+void* OS_CreateThread(void (*func)(void*), void* arg);
+
+// Wait for a thread started by OS_CreateThread to return, then release it
+void OS_JoinThread(void* thread);
+
+// Counting semaphore. OS_CreateSemaphore returns NULL on failure
+void* OS_CreateSemaphore(int initial_count);
+
+void OS_DestroySemaphore(void* semaphore);
+
+void OS_SemaphorePost(void* semaphore);
+
+void OS_SemaphoreWait(void* semaphore);
+
+// Map a whole file read-only into memory. Returns NULL when it cannot be mapped, or the platform cannot map files
+void* OS_MapFile(const char* path, size_t* size);
+
+void OS_UnmapFile(void* data, size_t size);
+
+// A read-only stream over `size` bytes at `data` that reads them in place. Returns NULL where the platform has no such stream
+FILE* OS_OpenMemory(void* data, size_t size);
+
 #endif
@@ -0,0 +1,24 @@
+#ifndef HARNESS_PACK_H
+#define HARNESS_PACK_H
+
+#include <stdio.h>
+
+// Serve reads of the game's files from one archive built by tools/pack_data.py, mapped into memory.
+// Paths inside it are relative to the directory that is current when it is mounted, and matched ignoring case
+
+// Returns 0 when the archive cannot be used, in which case every file comes from disk as before
+int Harness_Pack_Mount(const char* path);
+
+// A stream reading the packed copy of `pathname`, or NULL when the file must come from disk: it is not in the archive,
+// `mode` writes, or it has been written since the archive was mounted
+FILE* Harness_Pack_fopen(const char* pathname, const char* mode);
+
+// Whether Harness_Pack_fopen would serve a read of `pathname`
+int Harness_Pack_Contains(const char* pathname);
+
+// `pathname` has been replaced on disk without being opened for writing, by a rename say, so it must come from disk
+void Harness_Pack_Written(const char* pathname);
+
+void Harness_Pack_Unmount(void);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef HARNESS_PREFETCH_H
+#define HARNESS_PREFETCH_H
+
+#include <stdio.h>
+
+// Read a list of files into memory on a background thread while the main thread is busy decoding the ones before them.
+// Only the reading moves off the main thread, the caller still parses and registers everything itself
+
+// Start reading `paths`, in order, ahead of them being opened. Ends the batch before it when there is one.
+// Does nothing where a stream over memory is not supported, or the thread cannot be started
+void Harness_Prefetch_Files(const char* const* paths, int count);
+
+// A stream reading the prefetched copy of `pathname`, waiting for it to be read first if needed.
+// NULL when the file must come from disk: it is not in the batch, could not be read, or `mode` writes
+FILE* Harness_Prefetch_fopen(const char* pathname, const char* mode);
+
+// Stop reading and free the batch. Streams returned by Harness_Prefetch_fopen must be closed before this is called
+void Harness_Prefetch_Release(void);
+
+#endif
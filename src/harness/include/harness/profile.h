@@ -0,0 +1,49 @@
+#ifndef HARNESS_PROFILE_H
+#define HARNESS_PROFILE_H
+
+#include <stdint.h>
+
+// Instrumented zones. Add new zones before eProfile_zone_count and give them a name in harness_profile.c
+typedef enum tHarness_profile_zone {
+    eProfile_zone_net_receive,     // NetReceiveAndProcessMessages
+    eProfile_zone_opponents,       // MungeOpponents
+    eProfile_zone_physics,         // ApplyPhysicsToCars
+    eProfile_zone_pipe_cars,       // PipeCarPositions
+    eProfile_zone_car_graphics,    // MungeCarGraphics
+    eProfile_zone_pedestrians,     // MungePedestrians
+    eProfile_zone_render,          // RenderAFrame
+    eProfile_zone_present,         // Renderer_Present
+    eProfile_zone_car_job,         // one car moved by a physics job, on any thread
+    eProfile_zone_count
+} tHarness_profile_zone;
+
+// Non-zero when zones are being timed, either for `--profile` or `--benchmark`
+extern int harness_profile_active;
+
+// Start recording zones into per-thread ring buffers, written as a Chrome/Perfetto trace to `trace_path`
+void Harness_Profile_Init(const char* trace_path);
+
+void Harness_Profile_ZoneBegin(tHarness_profile_zone zone);
+
+void Harness_Profile_ZoneEnd(tHarness_profile_zone zone);
+
+// Write the recorded zones of every thread to the trace file. Called on exit and from the dump hotkey
+void Harness_Profile_Dump(void);
+
+const char* Harness_Profile_ZoneName(tHarness_profile_zone zone);
+
+#define PROFILE_ZONE_BEGIN(zone)              \
+    do {                                      \
+        if (harness_profile_active) {         \
+            Harness_Profile_ZoneBegin(zone);  \
+        }                                     \
+    } while (0)
+
+#define PROFILE_ZONE_END(zone)              \
+    do {                                    \
+        if (harness_profile_active) {       \
+            Harness_Profile_ZoneEnd(zone);  \
+        }                                   \
+    } while (0)
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef HARNESS_WRITER_H
+#define HARNESS_WRITER_H
+
+#include <stddef.h>
+
+// Write a file from a background thread, so that the caller never waits for the disk.
+// What is written is collected into blocks, each handed to the thread when it fills up or on Harness_Writer_Flush
+
+typedef struct tHarness_writer tHarness_writer;
+
+// Create `path` for writing. NULL when it cannot be created
+tHarness_writer* Harness_Writer_Open(const char* path);
+
+void Harness_Writer_Write(tHarness_writer* writer, const void* data, size_t size);
+
+// Hand everything written so far to the thread, so that it reaches the disk even if the game stops before closing
+void Harness_Writer_Flush(tHarness_writer* writer);
+
+// Wait for everything written to reach the disk, then close the file. Returns 0 when any of it could not be written
+int Harness_Writer_Close(tHarness_writer* writer);
+
+#endif
@@ -20,12 +20,18 @@
 
 #include <limits.h>
 
+#include <pthread.h>
+#include <semaphore.h>
+
 #include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>      
 #include <stdlib.h>
 #include <string.h>
+#ifndef __DREAMCAST__
+#include <sys/mman.h>
+#endif
 #include <sys/stat.h>
 #include <sys/types.h>
 
@@ -33,6 +39,8 @@
 #include <unistd.h>
 
 #ifdef __DREAMCAST__
+#include <arch/timer.h>
+
 // A stub of termios structure for Dreamcast (no termios.h)
 typedef unsigned int tcflag_t;
 typedef unsigned char cc_t;
@@ -291,38 +299,201 @@ void OS_InstallSignalHandler(char* program_name) {
 #endif    
 }
 
-FILE* OS_fopen(const char* pathname, const char* mode) {
-    FILE* f = fopen(pathname, mode);
-    if (f != NULL) {
-        return f;
-    }
-    char buffer[512];
-    char buffer2[512];
-    strcpy(buffer, pathname);
-    strcpy(buffer2, pathname);
-    #ifndef __DREAMCAST__
-    char* pDirName = (char *)dirname(buffer);
-    #else
-    char* pDirName = (char *)my_dirname(buffer);
-    #endif
-    char* pBaseName = basename(buffer2);
-    DIR* pDir = opendir(pDirName);
-    if (pDir == NULL) {
+// Directories OS_fopen has listed to find files named in a different case than asked for, so that each is read once
+// rather than on every open. A listing is read again once the directory's mtime changes, or a name from it fails to open
+typedef struct tDir_listing {
+    char* path;
+    long long mtime;
+    int name_count;
+    char** names;
+    uint32_t bucket_mask;
+    // name index + 1, 0 when empty, probed linearly from the hash of the lower case name
+    int* buckets;
+} tDir_listing;
+
+static pthread_mutex_t dir_listings_lock = PTHREAD_MUTEX_INITIALIZER;
+// open addressed by the hash of the path, grown to keep it at most half full
+static tDir_listing** dir_listings;
+static uint32_t dir_listings_mask;
+static int dir_listing_count;
+
+static uint32_t hash_name(const char* name, int fold) {
+    uint32_t hash = 0x811c9dc5;
+
+    for (; *name != '\0'; name++) {
+        hash = (hash ^ (uint8_t)(fold ? tolower((unsigned char)*name) : *name)) * 0x01000193;
+    }
+    return hash;
+}
+
+static long long dir_mtime(const struct stat* st) {
+#if defined(__DREAMCAST__)
+    return st->st_mtime;
+#else
+    return (long long)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
+
+static void clear_dir_listing(tDir_listing* listing) {
+    for (int i = 0; i < listing->name_count; i++) {
+        free(listing->names[i]);
+    }
+    free(listing->names);
+    free(listing->buckets);
+    listing->names = NULL;
+    listing->buckets = NULL;
+    listing->name_count = 0;
+}
+
+static void read_dir_listing(tDir_listing* listing, long long mtime) {
+    DIR* dir;
+    int capacity = 0;
+    uint32_t bucket_count;
+
+    clear_dir_listing(listing);
+    listing->mtime = mtime;
+    dir = opendir(listing->path);
+    if (dir != NULL) {
+        for (struct dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+            if (listing->name_count == capacity) {
+                capacity = capacity == 0 ? 64 : capacity * 2;
+                listing->names = realloc(listing->names, capacity * sizeof(char*));
+            }
+            listing->names[listing->name_count++] = strdup(entry->d_name);
+        }
+        closedir(dir);
+    }
+    for (bucket_count = 16; bucket_count < 2 * (uint32_t)listing->name_count; bucket_count *= 2) {
+    }
+    listing->bucket_mask = bucket_count - 1;
+    listing->buckets = calloc(bucket_count, sizeof(int));
+    // in the order readdir gave them, so the first match is the one a scan would have found
+    for (int i = 0; i < listing->name_count; i++) {
+        uint32_t bucket = hash_name(listing->names[i], 1) & listing->bucket_mask;
+        while (listing->buckets[bucket] != 0) {
+            bucket = (bucket + 1) & listing->bucket_mask;
+        }
+        listing->buckets[bucket] = i + 1;
+    }
+}
+
+// A name matching exactly wins, as fopen would have opened it, otherwise the first to match ignoring case
+static const char* find_in_dir_listing(tDir_listing* listing, const char* name) {
+    const char* found = NULL;
+
+    if (listing->buckets == NULL) {
         return NULL;
     }
-    for (struct dirent* pDirent = readdir(pDir); pDirent != NULL; pDirent = readdir(pDir)) {
-        if (strcasecmp(pBaseName, pDirent->d_name) == 0) {
-            strcat(pDirName, "/");
-            strcat(pDirName, pDirent->d_name);
-            f = fopen(pDirName, mode);
-            break;
+    for (uint32_t bucket = hash_name(name, 1) & listing->bucket_mask; listing->buckets[bucket] != 0; bucket = (bucket + 1) & listing->bucket_mask) {
+        const char* candidate = listing->names[listing->buckets[bucket] - 1];
+        if (strcmp(candidate, name) == 0) {
+            return candidate;
+        }
+        if (found == NULL && strcasecmp(candidate, name) == 0) {
+            found = candidate;
         }
     }
-    closedir(pDir);
+    return found;
+}
 
-#ifdef __DREAMCAST__
-        free(pDirName);
-#endif
+static tDir_listing* find_dir_listing(const char* path, int create) {
+    uint32_t slot;
+
+    if (dir_listings != NULL) {
+        for (slot = hash_name(path, 0) & dir_listings_mask; dir_listings[slot] != NULL; slot = (slot + 1) & dir_listings_mask) {
+            if (strcmp(dir_listings[slot]->path, path) == 0) {
+                return dir_listings[slot];
+            }
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    if (dir_listings == NULL || 2 * (dir_listing_count + 1) > (int)dir_listings_mask + 1) {
+        uint32_t old_size = dir_listings == NULL ? 0 : dir_listings_mask + 1;
+        tDir_listing** old = dir_listings;
+
+        dir_listings_mask = old_size == 0 ? 63 : 2 * old_size - 1;
+        dir_listings = calloc(dir_listings_mask + 1, sizeof(tDir_listing*));
+        for (uint32_t i = 0; i < old_size; i++) {
+            if (old[i] != NULL) {
+                for (slot = hash_name(old[i]->path, 0) & dir_listings_mask; dir_listings[slot] != NULL; slot = (slot + 1) & dir_listings_mask) {
+                }
+                dir_listings[slot] = old[i];
+            }
+        }
+        free(old);
+    }
+    for (slot = hash_name(path, 0) & dir_listings_mask; dir_listings[slot] != NULL; slot = (slot + 1) & dir_listings_mask) {
+    }
+    dir_listings[slot] = calloc(1, sizeof(tDir_listing));
+    dir_listings[slot]->path = strdup(path);
+    dir_listings[slot]->mtime = -1;
+    dir_listing_count++;
+    return dir_listings[slot];
+}
+
+// The file in `dir_path` called `name` ignoring case, as "<dir_path>/<actual name>" in `result`. `refresh` lists the
+// directory again if it changed since it was last listed, or always when `force` is set
+static int resolve_in_dir(const char* dir_path, const char* name, int refresh, int force, char* result, size_t result_size) {
+    tDir_listing* listing;
+    const char* actual;
+    struct stat st;
+    int found = 0;
+
+    if (refresh && (stat(dir_path, &st) != 0 || !S_ISDIR(st.st_mode))) {
+        return 0;
+    }
+    pthread_mutex_lock(&dir_listings_lock);
+    listing = find_dir_listing(dir_path, refresh);
+    if (listing != NULL) {
+        if (refresh && (force || listing->mtime != dir_mtime(&st))) {
+            read_dir_listing(listing, dir_mtime(&st));
+        }
+        actual = find_in_dir_listing(listing, name);
+        if (actual != NULL && (size_t)snprintf(result, result_size, "%s/%s", strcmp(dir_path, "/") == 0 ? "" : dir_path, actual) < result_size) {
+            found = 1;
+        }
+    }
+    pthread_mutex_unlock(&dir_listings_lock);
+    return found;
+}
+
+FILE* OS_fopen(const char* pathname, const char* mode) {
+    FILE* f;
+    char dir_path[512];
+    char resolved[1024];
+    const char* name;
+    const char* separator;
+    int listed;
+
+    separator = strrchr(pathname, '/');
+    if (separator == NULL) {
+        strcpy(dir_path, ".");
+        name = pathname;
+    } else if (separator == pathname) {
+        strcpy(dir_path, "/");
+        name = separator + 1;
+    } else if ((size_t)(separator - pathname) < sizeof(dir_path)) {
+        memcpy(dir_path, pathname, separator - pathname);
+        dir_path[separator - pathname] = '\0';
+        name = separator + 1;
+    } else {
+        return fopen(pathname, mode);
+    }
+
+    // a name found before is usually still right, and saves opening the one asked for first only to fail
+    listed = resolve_in_dir(dir_path, name, 0, 0, resolved, sizeof(resolved));
+    if (listed) {
+        f = fopen(resolved, mode);
+        if (f != NULL) {
+            return f;
+        }
+    }
+    f = fopen(pathname, mode);
+    if (f == NULL && resolve_in_dir(dir_path, name, 1, listed, resolved, sizeof(resolved))) {
+        f = fopen(resolved, mode);
+    }
 
     if (harness_game_config.verbose) {
         if (f == NULL) {
@@ -392,3 +563,128 @@ char* OS_Basename(const char* path) {
 char* OS_GetWorkingDirectory(char* argv0) {
     return OS_Dirname(argv0);
 }
+
+uint64_t OS_GetMicroseconds(void) {
+#ifdef __DREAMCAST__
+    return timer_us_gettime64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+int OS_GetProcessorCount(void) {
+#ifdef __DREAMCAST__
+    return 1;
+#else
+    long count;
+
+    count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+typedef struct tOS_thread {
+    pthread_t handle;
+    void (*func)(void*);
+    void* arg;
+} tOS_thread;
+
+static void* thread_start(void* arg) {
+    tOS_thread* thread = arg;
+
+    thread->func(thread->arg);
+    return NULL;
+}
+
+void* OS_CreateThread(void (*func)(void*), void* arg) {
+    tOS_thread* thread;
+
+    thread = malloc(sizeof(tOS_thread));
+    if (thread == NULL) {
+        return NULL;
+    }
+    thread->func = func;
+    thread->arg = arg;
+    if (pthread_create(&thread->handle, NULL, thread_start, thread) != 0) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void OS_JoinThread(void* thread) {
+    pthread_join(((tOS_thread*)thread)->handle, NULL);
+    free(thread);
+}
+
+void* OS_CreateSemaphore(int initial_count) {
+    sem_t* semaphore;
+
+    semaphore = malloc(sizeof(sem_t));
+    if (semaphore == NULL) {
+        return NULL;
+    }
+    if (sem_init(semaphore, 0, initial_count) != 0) {
+        free(semaphore);
+        return NULL;
+    }
+    return semaphore;
+}
+
+void OS_DestroySemaphore(void* semaphore) {
+    sem_destroy(semaphore);
+    free(semaphore);
+}
+
+void OS_SemaphorePost(void* semaphore) {
+    sem_post(semaphore);
+}
+
+void OS_SemaphoreWait(void* semaphore) {
+    // retry when a signal interrupts the wait
+    while (sem_wait(semaphore) != 0 && errno == EINTR) {
+    }
+}
+
+void* OS_MapFile(const char* path, size_t* size) {
+#ifdef __DREAMCAST__
+    return NULL;
+#else
+    struct stat st;
+    void* data;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps the file open
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    *size = st.st_size;
+    return data;
+#endif
+}
+
+void OS_UnmapFile(void* data, size_t size) {
+#ifndef __DREAMCAST__
+    munmap(data, size);
+#endif
+}
+
+FILE* OS_OpenMemory(void* data, size_t size) {
+#ifdef __DREAMCAST__
+    return NULL;
+#else
+    return fmemopen(data, size, "rb");
+#endif
+}
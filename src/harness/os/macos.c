@@ -3,20 +3,25 @@
 #include "harness/config.h"
 #include "harness/os.h"
 #include <assert.h>
+#include <dispatch/dispatch.h>
 #include <dirent.h>
 #include <err.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <execinfo.h>
 #include <inttypes.h>
 #include <libgen.h>
 #include <limits.h>
 #include <mach-o/dyld.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/sysctl.h>
 #include <sys/types.h>
 #include <time.h>
@@ -259,3 +264,96 @@ char* OS_GetWorkingDirectory(char* argv0) {
     }
     return OS_Dirname(argv0);
 }
+
+uint64_t OS_GetMicroseconds(void) {
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW) / 1000;
+}
+
+int OS_GetProcessorCount(void) {
+    long count;
+
+    count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+typedef struct tOS_thread {
+    pthread_t handle;
+    void (*func)(void*);
+    void* arg;
+} tOS_thread;
+
+static void* thread_start(void* arg) {
+    tOS_thread* thread = arg;
+
+    thread->func(thread->arg);
+    return NULL;
+}
+
+void* OS_CreateThread(void (*func)(void*), void* arg) {
+    tOS_thread* thread;
+
+    thread = malloc(sizeof(tOS_thread));
+    if (thread == NULL) {
+        return NULL;
+    }
+    thread->func = func;
+    thread->arg = arg;
+    if (pthread_create(&thread->handle, NULL, thread_start, thread) != 0) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void OS_JoinThread(void* thread) {
+    pthread_join(((tOS_thread*)thread)->handle, NULL);
+    free(thread);
+}
+
+// unnamed POSIX semaphores are not implemented on macOS
+void* OS_CreateSemaphore(int initial_count) {
+    return (void*)dispatch_semaphore_create(initial_count);
+}
+
+void OS_DestroySemaphore(void* semaphore) {
+    dispatch_release((dispatch_semaphore_t)semaphore);
+}
+
+void OS_SemaphorePost(void* semaphore) {
+    dispatch_semaphore_signal((dispatch_semaphore_t)semaphore);
+}
+
+void OS_SemaphoreWait(void* semaphore) {
+    dispatch_semaphore_wait((dispatch_semaphore_t)semaphore, DISPATCH_TIME_FOREVER);
+}
+
+void* OS_MapFile(const char* path, size_t* size) {
+    struct stat st;
+    void* data;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps the file open
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    *size = st.st_size;
+    return data;
+}
+
+void OS_UnmapFile(void* data, size_t size) {
+    munmap(data, size);
+}
+
+FILE* OS_OpenMemory(void* data, size_t size) {
+    return fmemopen(data, size, "rb");
+}
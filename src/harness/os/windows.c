@@ -357,3 +357,112 @@ char* OS_Basename(const char* path) {
 char* OS_GetWorkingDirectory(char* argv0) {
     return OS_Dirname(argv0);
 }
+
+uint64_t OS_GetMicroseconds(void) {
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000
+        + (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+}
+
+int OS_GetProcessorCount(void) {
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+typedef struct tOS_thread {
+    HANDLE handle;
+    void (*func)(void*);
+    void* arg;
+} tOS_thread;
+
+static DWORD WINAPI thread_start(LPVOID arg) {
+    tOS_thread* thread = arg;
+
+    thread->func(thread->arg);
+    return 0;
+}
+
+void* OS_CreateThread(void (*func)(void*), void* arg) {
+    tOS_thread* thread;
+
+    thread = malloc(sizeof(tOS_thread));
+    if (thread == NULL) {
+        return NULL;
+    }
+    thread->func = func;
+    thread->arg = arg;
+    thread->handle = CreateThread(NULL, 0, thread_start, thread, 0, NULL);
+    if (thread->handle == NULL) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void OS_JoinThread(void* thread) {
+    WaitForSingleObject(((tOS_thread*)thread)->handle, INFINITE);
+    CloseHandle(((tOS_thread*)thread)->handle);
+    free(thread);
+}
+
+void* OS_CreateSemaphore(int initial_count) {
+    return CreateSemaphore(NULL, initial_count, MAXLONG, NULL);
+}
+
+void OS_DestroySemaphore(void* semaphore) {
+    CloseHandle(semaphore);
+}
+
+void OS_SemaphorePost(void* semaphore) {
+    ReleaseSemaphore(semaphore, 1, NULL);
+}
+
+void OS_SemaphoreWait(void* semaphore) {
+    WaitForSingleObject(semaphore, INFINITE);
+}
+
+void* OS_MapFile(const char* path, size_t* size) {
+    HANDLE file;
+    HANDLE mapping;
+    LARGE_INTEGER file_size;
+    void* data;
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) {
+        return NULL;
+    }
+    data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    // the view keeps the mapping alive
+    CloseHandle(mapping);
+    if (data == NULL) {
+        return NULL;
+    }
+    *size = (size_t)file_size.QuadPart;
+    return data;
+}
+
+void OS_UnmapFile(void* data, size_t size) {
+    UnmapViewOfFile(data);
+}
+
+FILE* OS_OpenMemory(void* data, size_t size) {
+    // the CRT has no stream over memory, callers read the file itself instead
+    return NULL;
+}
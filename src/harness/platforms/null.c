@@ -40,6 +40,9 @@ static int null_show_cursor(int show) {
 static void null_set_palette(PALETTEENTRY_* palette) {
 }
 
+static void null_present(br_pixelmap* src) {
+}
+
 void Null_Platform_Init(tHarness_platform* platform) {
     platform->ProcessWindowMessages = null_get_and_handle_message;
     // todo: shouldnt depend on sdl...
@@ -55,4 +58,5 @@ void Null_Platform_Init(tHarness_platform* platform) {
     platform->ShowErrorMessage = null_show_error_message;
 
     platform->Renderer_SetPalette = null_set_palette;
+    platform->Renderer_Present = null_present;
 }
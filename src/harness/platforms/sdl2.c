@@ -3,14 +3,23 @@
 #include "harness.h"
 #include "harness/config.h"
 #include "harness/hooks.h"
+#include "harness/profile.h"
 #include "harness/trace.h"
 #include "sdl2_scancode_to_dinput.h"
 #include "sdl2_gamepad_to_dinput.h"
+
+#include <stdlib.h>
+#include <string.h>
+
 SDL_Window* window;
 SDL_Renderer* renderer;
 SDL_Texture* screen_texture;
 uint32_t converted_palette[256];
 br_pixelmap* last_screen_src;
+// Copy of the last presented frame. Rows that still match it are neither converted nor uploaded again
+static uint8_t* last_frame_pixels;
+static int last_frame_width, last_frame_height;
+static int last_frame_valid;
 int render_width, render_height;
 
 Uint32 last_frame_time;
@@ -86,6 +95,10 @@ static int set_window_pos(void* hWnd, int x, int y, int nWidth, int nHeight) {
 }
 
 static void destroy_window(void* hWnd) {
+    free(last_frame_pixels);
+    last_frame_pixels = NULL;
+    last_frame_width = 0;
+    last_frame_height = 0;
     // SDL_GL_DeleteContext(context);
     SDL_DestroyWindow(window);
     SDL_Quit();
@@ -106,6 +119,11 @@ static int get_and_handle_message(MSG_* msg) {
         switch (event.type) {
             case SDL_KEYDOWN:
             case SDL_KEYUP:
+                if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F12 && is_only_key_modifier(event.key.keysym.mod, KMOD_CTRL)) {
+                    // ctrl+F12 writes the frame profiler trace without quitting
+                    Harness_Profile_Dump();
+                    break;
+                }
                 dinput_key = sdlScanCodeToDirectInputKeyNum[event.key.keysym.scancode];
                 if (dinput_key != 0) {
                     directinput_key_state[dinput_key] = (event.type == SDL_KEYDOWN ? 0x80 : 0);
@@ -210,19 +228,83 @@ static void limit_fps(void) {
     last_frame_time = SDL_GetTicks();
 }
 
-static void present_screen(br_pixelmap* src) {
-    // fastest way to convert 8 bit indexed to 32 bit
-    uint8_t* src_pixels = src->pixels;
-    uint32_t* dest_pixels;
+// Convert one scanline of palette indices to ARGB8888
+static void convert_row(uint32_t* dest, const uint8_t* src, int width) {
+    for (; width >= 4; width -= 4) {
+        dest[0] = converted_palette[src[0]];
+        dest[1] = converted_palette[src[1]];
+        dest[2] = converted_palette[src[2]];
+        dest[3] = converted_palette[src[3]];
+        dest += 4;
+        src += 4;
+    }
+    for (; width > 0; width--) {
+        *dest++ = converted_palette[*src++];
+    }
+}
+
+// Convert and upload rows [first, last) of `src` into the screen texture
+static void upload_rows(br_pixelmap* src, int first, int last) {
+    SDL_Rect rect;
+    uint8_t* src_pixels;
+    uint8_t* dest_pixels;
     int dest_pitch;
+    int y;
 
-    SDL_LockTexture(screen_texture, NULL, (void**)&dest_pixels, &dest_pitch);
-    for (int i = 0; i < src->height * src->width; i++) {
-        *dest_pixels = converted_palette[*src_pixels];
-        dest_pixels++;
-        src_pixels++;
+    rect.x = 0;
+    rect.y = first;
+    rect.w = src->width;
+    rect.h = last - first;
+    if (SDL_LockTexture(screen_texture, &rect, (void**)&dest_pixels, &dest_pitch) != 0) {
+        return;
+    }
+    src_pixels = (uint8_t*)src->pixels + first * src->row_bytes;
+    for (y = first; y < last; y++) {
+        convert_row((uint32_t*)dest_pixels, src_pixels, src->width);
+        memcpy(last_frame_pixels + y * src->width, src_pixels, src->width);
+        dest_pixels += dest_pitch;
+        src_pixels += src->row_bytes;
     }
     SDL_UnlockTexture(screen_texture);
+}
+
+static void present_screen(br_pixelmap* src) {
+    uint8_t* src_pixels;
+    int first_dirty;
+    int y;
+
+    if (last_frame_width != src->width || last_frame_height != src->height) {
+        free(last_frame_pixels);
+        last_frame_pixels = malloc(src->width * src->height);
+        if (last_frame_pixels == NULL) {
+            LOG_PANIC("Failed to allocate %dx%d frame copy", src->width, src->height);
+        }
+        last_frame_width = src->width;
+        last_frame_height = src->height;
+        last_frame_valid = 0;
+    }
+    if (!last_frame_valid) {
+        upload_rows(src, 0, src->height);
+        last_frame_valid = 1;
+    } else {
+        // upload each run of changed scanlines with its own lock, the texture keeps the rest
+        src_pixels = src->pixels;
+        first_dirty = -1;
+        for (y = 0; y < src->height; y++) {
+            if (memcmp(src_pixels, last_frame_pixels + y * src->width, src->width) != 0) {
+                if (first_dirty < 0) {
+                    first_dirty = y;
+                }
+            } else if (first_dirty >= 0) {
+                upload_rows(src, first_dirty, y);
+                first_dirty = -1;
+            }
+            src_pixels += src->row_bytes;
+        }
+        if (first_dirty >= 0) {
+            upload_rows(src, first_dirty, src->height);
+        }
+    }
     SDL_RenderClear(renderer);
     //SDL_RenderCopyEx(renderer, screen_texture, NULL, NULL, 0, NULL, SDL_FLIP_VERTICAL | SDL_FLIP_HORIZONTAL);
     SDL_RenderCopy(renderer, screen_texture, NULL, NULL);
@@ -240,6 +322,8 @@ static void set_palette(PALETTEENTRY_* pal) {
     for (int i = 0; i < 256; i++) {
         converted_palette[i] = (0xff << 24 | pal[i].peBlue << 16 | pal[i].peGreen << 8 | pal[i].peRed);
     }
+    // every row has to be converted again with the new colours
+    last_frame_valid = 0;
     if (last_screen_src != NULL) {
         present_screen(last_screen_src);
     }
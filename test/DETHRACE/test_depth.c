@@ -0,0 +1,142 @@
+#include "tests.h"
+
+#include "common/depth.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define DEPTH_TEST_MAX_WIDTH 67
+#define DEPTH_TEST_MAX_HEIGHT 9
+#define DEPTH_TEST_MAX_PADDING 13
+
+static tU8 shade_table_pixels[256 * 256];
+
+// DoDepthByShadeTable as it was before it tested 16 depths at a time
+static void reference_depth_by_shade_table(br_pixelmap* pRender_buffer, br_pixelmap* pDepth_buffer, br_pixelmap* pShade_table, int pShade_table_power, int pStart, int pEnd) {
+    tU8* render_ptr;
+    tU8* shade_table_pixels;
+    tU16* depth_ptr;
+    tU16 depth_value;
+    tU16 too_near;
+    int depth_shift_amount;
+    int y;
+    int x;
+    int depth_line_skip;
+    int render_line_skip;
+
+    too_near = 0xffff - (1 << pStart);
+    shade_table_pixels = pShade_table->pixels;
+    depth_shift_amount = pShade_table_power + 8 - pStart - pEnd;
+    render_ptr = (tU8*)pRender_buffer->pixels + pRender_buffer->base_x + pRender_buffer->base_y * pRender_buffer->row_bytes;
+    depth_ptr = pDepth_buffer->pixels;
+    render_line_skip = pRender_buffer->row_bytes - pRender_buffer->width;
+    depth_line_skip = pDepth_buffer->row_bytes / 2 - pRender_buffer->width;
+
+    for (y = 0; y < pRender_buffer->height; y++) {
+        for (x = 0; x < pRender_buffer->width; x++) {
+            if (*depth_ptr != 0xFFFF) {
+                depth_value = *depth_ptr - too_near;
+                if (depth_value < -(int16_t)too_near) {
+                    if (depth_shift_amount >= 0) {
+                        *render_ptr = shade_table_pixels[*render_ptr + ((depth_value << depth_shift_amount) & 0xFF00)];
+                    } else {
+                        *render_ptr = shade_table_pixels[*render_ptr + ((depth_value >> -depth_shift_amount) & 0xFF00)];
+                    }
+                }
+            }
+            render_ptr++;
+            depth_ptr++;
+        }
+        render_ptr += render_line_skip;
+        depth_ptr += depth_line_skip;
+    }
+}
+
+// Mostly depths the effect leaves alone, as on screen, with runs of shaded and cleared pixels
+static tU16 random_depth(int pStart) {
+    int r;
+
+    r = rand() % 8;
+    if (r == 0) {
+        return 0xFFFF;
+    }
+    if (r < 3) {
+        return 0xFFFF - (rand() % ((1 << pStart) + 2));
+    }
+    return rand() & 0xFFFF;
+}
+
+void test_depth_DoDepthByShadeTable_matches_original() {
+    static tU8 render_pixels[2][(DEPTH_TEST_MAX_HEIGHT + 1) * (DEPTH_TEST_MAX_WIDTH + DEPTH_TEST_MAX_PADDING)];
+    static tU16 depth_pixels[DEPTH_TEST_MAX_HEIGHT * (DEPTH_TEST_MAX_WIDTH + DEPTH_TEST_MAX_PADDING)];
+    static const int shifts[][3] = {
+        // power, start, end: shifting left, not at all and right
+        { 8, 4, 8 },
+        { 8, 2, 4 },
+        { 8, 8, 8 },
+        { 8, 1, 15 },
+        { 8, 12, 6 },
+        { 6, 14, 4 },
+        // and starts too far off for the original test ever to shade
+        { 8, 15, 1 },
+        { 8, 16, 0 },
+    };
+    br_pixelmap render_buffer[2];
+    br_pixelmap depth_buffer;
+    br_pixelmap shade_table;
+    int render_padding;
+    int depth_padding;
+    int trial;
+    int s;
+    int i;
+
+    srand(1234);
+    for (i = 0; i < (int)sizeof(shade_table_pixels); i++) {
+        shade_table_pixels[i] = rand();
+    }
+    memset(&shade_table, 0, sizeof(shade_table));
+    shade_table.pixels = shade_table_pixels;
+    shade_table.width = 256;
+    shade_table.height = 256;
+    shade_table.row_bytes = 256;
+
+    for (s = 0; s < BR_ASIZE(shifts); s++) {
+        for (trial = 0; trial < 200; trial++) {
+            memset(render_buffer, 0, sizeof(render_buffer));
+            memset(&depth_buffer, 0, sizeof(depth_buffer));
+            // every width from a single pixel past several 16 pixel blocks, so both the vector and per pixel loops run
+            render_buffer[0].width = 1 + trial % DEPTH_TEST_MAX_WIDTH;
+            render_buffer[0].height = 1 + rand() % DEPTH_TEST_MAX_HEIGHT;
+            render_padding = rand() % DEPTH_TEST_MAX_PADDING;
+            depth_padding = rand() % DEPTH_TEST_MAX_PADDING;
+            render_buffer[0].row_bytes = render_buffer[0].width + render_padding;
+            render_buffer[0].base_x = rand() % (render_padding + 1);
+            render_buffer[0].base_y = rand() % 2;
+            depth_buffer.width = render_buffer[0].width;
+            depth_buffer.height = render_buffer[0].height;
+            depth_buffer.row_bytes = 2 * (render_buffer[0].width + depth_padding);
+            depth_buffer.pixels = depth_pixels;
+
+            for (i = 0; i < (int)BR_ASIZE(depth_pixels); i++) {
+                depth_pixels[i] = random_depth(shifts[s][1]);
+            }
+            for (i = 0; i < (int)sizeof(render_pixels[0]); i++) {
+                render_pixels[0][i] = rand();
+            }
+            memcpy(render_pixels[1], render_pixels[0], sizeof(render_pixels[0]));
+            render_buffer[1] = render_buffer[0];
+            render_buffer[0].pixels = render_pixels[0];
+            render_buffer[1].pixels = render_pixels[1];
+
+            reference_depth_by_shade_table(&render_buffer[0], &depth_buffer, &shade_table, shifts[s][0], shifts[s][1], shifts[s][2]);
+            DoDepthByShadeTable(&render_buffer[1], &depth_buffer, &shade_table, shifts[s][0], shifts[s][1], shifts[s][2]);
+            // the padding and the rows outside the buffer must be left alone as well
+            TEST_ASSERT_EQUAL_MEMORY(render_pixels[0], render_pixels[1], sizeof(render_pixels[0]));
+        }
+    }
+}
+
+void test_depth_suite() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_depth_DoDepthByShadeTable_matches_original);
+}
@@ -2,6 +2,7 @@
 
 #include "common/loading.h"
 #include "common/utility.h"
+#include <stdlib.h>
 #include <string.h>
 
 void test_utility_EncodeLinex() {
@@ -128,6 +129,84 @@ void test_utility_IRandomBetween() {
     }
 }
 
+static void check_palette_matches(br_pixelmap* pPalette) {
+    tRGB_colour colour;
+    br_colour* dp;
+    int i;
+
+    dp = pPalette->pixels;
+    PreparePaletteMatch(pPalette);
+    for (i = 0; i < 20000; i++) {
+        switch (i % 4) {
+        case 0:
+            // the palette's own colours, and their neighbours
+            colour.red = ((dp[i / 4 % 256] >> 16) & 0xff) + (rand() % 3) - 1;
+            colour.green = ((dp[i / 4 % 256] >> 8) & 0xff) + (rand() % 3) - 1;
+            colour.blue = ((dp[i / 4 % 256] >> 0) & 0xff) + (rand() % 3) - 1;
+            break;
+        case 1:
+            // either side of a cell boundary
+            colour.red = (rand() % 32) * 8 - (rand() % 2);
+            colour.green = (rand() % 32) * 8 - (rand() % 2);
+            colour.blue = (rand() % 32) * 8 - (rand() % 2);
+            break;
+        case 2:
+            // out of range, as darkened and mixed colours can be
+            colour.red = rand() % 400 - 50;
+            colour.green = rand() % 400 - 50;
+            colour.blue = rand() % 400 - 50;
+            break;
+        default:
+            colour.red = rand() % 256;
+            colour.green = rand() % 256;
+            colour.blue = rand() % 256;
+            break;
+        }
+        TEST_ASSERT_EQUAL_INT(FindBestMatch(&colour, pPalette), FindBestMatchInCells(&colour, pPalette));
+    }
+}
+
+void test_utility_FindBestMatchInCells() {
+    br_colour colours[256];
+    br_pixelmap palette;
+    int i;
+    int step;
+
+    srand(1234);
+    memset(&palette, 0, sizeof(palette));
+    palette.pixels = colours;
+    palette.width = 1;
+    palette.height = 256;
+
+    // a random palette
+    for (i = 0; i < 256; i++) {
+        colours[i] = ((rand() % 256) << 16) | ((rand() % 256) << 8) | (rand() % 256);
+    }
+    check_palette_matches(&palette);
+
+    // every colour twice, the lower index must win
+    for (i = 0; i < 256; i += 2) {
+        colours[i] = ((rand() % 256) << 16) | ((rand() % 256) << 8) | (rand() % 256);
+        colours[i + 1] = colours[i];
+    }
+    check_palette_matches(&palette);
+
+    // duplicates far apart in the palette, and on a coarse lattice so many colours are equally far from several entries
+    for (step = 16; step <= 64; step *= 2) {
+        for (i = 0; i < 128; i++) {
+            colours[i] = ((rand() % (256 / step) * step) << 16) | ((rand() % (256 / step) * step) << 8) | (rand() % (256 / step) * step);
+            colours[255 - i] = colours[i];
+        }
+        check_palette_matches(&palette);
+    }
+
+    // a single colour throughout
+    for (i = 0; i < 256; i++) {
+        colours[i] = 0x406080;
+    }
+    check_palette_matches(&palette);
+}
+
 void test_utility_suite() {
     UnitySetTestFile(__FILE__);
     RUN_TEST(test_utility_EncodeLinex);
@@ -137,4 +216,5 @@ void test_utility_suite() {
     RUN_TEST(test_utility_GetALineWithNoPossibleService);
     RUN_TEST(test_utility_PathCat);
     RUN_TEST(test_utility_IRandomBetween);
+    RUN_TEST(test_utility_FindBestMatchInCells);
 }
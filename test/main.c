@@ -36,6 +36,7 @@ extern void test_init_suite();
 extern void test_graphics_suite();
 extern void test_powerup_suite();
 extern void test_flicplay_suite();
+extern void test_depth_suite();
 
 char* root_dir;
 
@@ -233,6 +234,7 @@ int main(int argc, char** argv) {
     test_graphics_suite();
     test_powerup_suite();
     test_flicplay_suite();
+    test_depth_suite();
 
     return UNITY_END();
 }
@@ -0,0 +1,130 @@
+#!/usr/bin/env python
+
+# Bundle a game's DATA directory into one archive for `dethrace --pack=<file>`.
+# Rebuild it whenever the files change: the game reads the packed copy in preference to the one on disk.
+# Files the game writes are left out so that they always come from disk.
+
+import argparse
+import os
+import struct
+import sys
+
+PACK_MAGIC = 0x4b415044  # "DPAK"
+PACK_VERSION = 1
+HEADER_FORMAT = "<8I"
+ENTRY_FORMAT = "<5I"
+DATA_ALIGNMENT = 16
+
+# folded paths relative to DATA, see harness_pack.c
+SKIP_DIRECTORIES = ("savegame", "shadetab")
+SKIP_FILES = ("options.txt", "diagnost.txt")
+SKIP_PREFIXES = ("keymap_",)
+SKIP_SUFFIXES = (".tmp", ".rpl", ".drv", ".pvs")
+
+
+def fnv1a(data: bytes) -> int:
+    h = 0x811c9dc5
+    for b in data:
+        h = ((h ^ b) * 0x01000193) & 0xffffffff
+    return h
+
+
+def fold(path: str) -> str:
+    return path.replace("\\", "/").lower()
+
+
+def find_data_dir(root: str) -> str:
+    for name in os.listdir(root):
+        if name.lower() == "data" and os.path.isdir(os.path.join(root, name)):
+            return name
+    raise SystemExit(f"No DATA directory in \"{root}\"")
+
+
+def skipped(relative_to_data: str) -> bool:
+    parts = relative_to_data.split("/")
+    base = parts[-1]
+    return (parts[0] in SKIP_DIRECTORIES
+            or base in SKIP_FILES
+            or base.startswith(SKIP_PREFIXES)
+            or base.endswith(SKIP_SUFFIXES))
+
+
+def collect(root: str) -> list:
+    data_dir = find_data_dir(root)
+    files = []
+    for directory, subdirectories, names in os.walk(os.path.join(root, data_dir)):
+        subdirectories.sort()
+        for name in sorted(names):
+            path = os.path.join(directory, name)
+            relative = fold(os.path.relpath(path, root))
+            if skipped(relative.split("/", 1)[1]):
+                continue
+            files.append((relative, path))
+    return files
+
+
+def write_pack(files: list, output: str) -> None:
+    bucket_count = 1
+    while bucket_count < 2 * len(files) + 1:
+        bucket_count *= 2
+
+    header_size = struct.calcsize(HEADER_FORMAT)
+    entries_offset = header_size
+    buckets_offset = entries_offset + len(files) * struct.calcsize(ENTRY_FORMAT)
+    names_offset = buckets_offset + bucket_count * 4
+
+    names = bytearray()
+    name_offsets = []
+    for relative, _ in files:
+        name_offsets.append(len(names))
+        names += relative.encode("latin-1")
+    data_offset = names_offset + len(names)
+    data_offset += -data_offset % DATA_ALIGNMENT
+
+    buckets = [0] * bucket_count
+    entries = bytearray()
+    offset = data_offset
+    sizes = []
+    for index, (relative, path) in enumerate(files):
+        encoded = relative.encode("latin-1")
+        h = fnv1a(encoded)
+        bucket = h & (bucket_count - 1)
+        while buckets[bucket] != 0:
+            bucket = (bucket + 1) & (bucket_count - 1)
+        buckets[bucket] = index + 1
+        size = os.path.getsize(path)
+        sizes.append(size)
+        entries += struct.pack(ENTRY_FORMAT, h, name_offsets[index], len(encoded), offset, size)
+        offset += size + (-size % DATA_ALIGNMENT)
+    if offset > 0xffffffff:
+        raise SystemExit("The files do not fit in a 4GB pack")
+
+    temporary = output + ".tmp"
+    with open(temporary, "wb") as f:
+        f.write(struct.pack(HEADER_FORMAT, PACK_MAGIC, PACK_VERSION, len(files), bucket_count,
+                            buckets_offset, entries_offset, names_offset, data_offset))
+        f.write(entries)
+        f.write(struct.pack(f"<{bucket_count}I", *buckets))
+        f.write(names)
+        f.write(b"\0" * (data_offset - f.tell()))
+        for (_, path), size in zip(files, sizes):
+            with open(path, "rb") as source:
+                f.write(source.read())
+            f.write(b"\0" * (-size % DATA_ALIGNMENT))
+    os.replace(temporary, output)
+
+
+def main():
+    parser = argparse.ArgumentParser(allow_abbrev=False, description="Pack a Carmageddon DATA directory for dethrace --pack")
+    parser.add_argument("root", metavar="ROOT", help="game directory, the one containing DATA")
+    parser.add_argument("-o", "--output", help="archive to write (default=ROOT/DATA.PAK)")
+    args = parser.parse_args()
+
+    output = args.output or os.path.join(args.root, "DATA.PAK")
+    files = collect(args.root)
+    write_pack(files, output)
+    print(f"Packed {len(files)} files into \"{output}\"", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())